@@ -0,0 +1,102 @@
+// Steady-state request throughput with and without the block pool.
+//
+// Every thread repeatedly parses a request, reads and changes a few fields and serializes
+// the response, as a server handling the same kind of requests would.
+//
+// usage: concise_json_schema_benchmark [threads] [seconds per run]
+
+#include "concise_json_schema/Json.h"
+#include "concise_json_schema/JsonPointer.h"
+#include "concise_json_schema/JsonPool.h"
+#include "concise_json_schema/JsonWriter.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace JSON;
+
+namespace {
+
+std::string make_request() {
+  std::string text = R"({"id": 12345, "method": "update", "user": {"name": "user name", "roles": ["admin", "dev"]},
+                         "items": [)";
+  for (int i = 0; i < 50; ++i) {
+    text += (i ? ", " : "");
+    text += R"({"sku": "item-)" + std::to_string(i) + R"(", "count": )" + std::to_string(i % 7) +
+            R"(, "price": )" + std::to_string(i * 1.25) + R"(, "tags": ["a", "b"], "meta": {"seen": true}})";
+  }
+  text += "]}";
+  return text;
+}
+
+size_t handle(const std::string& request, const JsonPointer& count, std::string& response) {
+  Json json = parse(request);
+  if (Json* value = count.find(json)) {
+    *value = Json(value->get_integer() + 1);
+  }
+  json("status") = Json("ok");
+  response.clear();
+  StringWriter writer(response);
+  writer.write_json(json);
+  writer.flush();
+  return response.size();
+}
+
+double requests_per_second(const std::string& request, size_t threads, double seconds) {
+  std::atomic<bool> stop{false};
+  std::atomic<size_t> total{0};
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&] {
+      JsonPointer count("/items/3/count");
+      std::string response;
+      size_t done = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        handle(request, count, response);
+        ++done;
+      }
+      total += done;
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+  stop = true;
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return total / seconds;
+}
+
+}
+
+int main(int argc, char** argv) {
+  size_t threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::thread::hardware_concurrency();
+  double seconds = argc > 2 ? std::strtod(argv[2], nullptr) : 2.0;
+  threads = std::max<size_t>(threads, 1);
+  std::string request = make_request();
+
+  std::cout << "request: " << request.size() << " bytes, threads: " << threads << "\n";
+  for (bool pool : {false, true, false, true}) {
+    set_pool_enabled(pool);
+    double rate = requests_per_second(request, threads, seconds);
+    std::cout << (pool ? "pool:    " : "no pool: ") << size_t(rate) << " requests/s\n";
+  }
+
+  // counters of one thread for a few requests
+  trim_pool();
+  PoolStats before = pool_stats();
+  JsonPointer count("/items/3/count");
+  std::string response;
+  for (int i = 0; i < 100; ++i) {
+    handle(request, count, response);
+  }
+  PoolStats after = pool_stats();
+  std::cout << "blocks per request: " << (after.allocated - before.allocated) / 100
+            << ", reused: " << 100.0 * (after.reused - before.reused) / (after.allocated - before.allocated) << "%"
+            << ", cached: " << after.cached << " blocks, " << after.cached_bytes << " bytes\n";
+  return 0;
+}
@@ -1,34 +1,67 @@
 #pragma once
 
-#include <variant>
-
+#include <algorithm>
 #include <cstdint>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 
 namespace JSON {
 
+class Interner;
 class Json;
+class Writer;
+
+// Parsing options, defaults are used by operator>>
+struct ParseOptions {
+  // objects keep the source key order, see Json::Object::Order::Insertion
+  bool preserve_key_order = false;
+  // arrays of only integers or only doubles use packed storage, see Json::packed_integers()
+  bool pack_numeric_arrays = true;
+  // equal arrays, objects and strings share storage with values already in the interner
+  Interner* interner = nullptr;
+};
+
+Json parse(std::istream& in, const ParseOptions& options = {});
+Json parse(std::string_view text, const ParseOptions& options = {});
 
 std::istream& operator>>(std::istream& in, Json& json);
 std::ostream& operator<<(std::ostream& out, const Json& json);
 
+// JSON value.
+//
+// Copies are deep. share() makes an O(1) copy instead, which shares the reference counted heap
+// blocks of arrays, objects and strings. Non-const accessors copy a shared block first (one level,
+// children stay shared), so changes are never visible through other copies. Values which handed
+// out references through non-const accessors, and their parents, are copied by share() rather
+// than shared, so a change through such a reference does not reach the copy either. Arrays and
+// objects moved into a Json must not be changed through references kept from before the move.
+// Copies may be used from different threads, one Json object must not be modified concurrently.
+//
+// A node is 16 bytes, booleans and numbers are stored in it. Every string value, however short,
+// takes a separate 64-byte pooled block (counters and caches plus a std::string, which holds up
+// to 15 characters itself), so documents made mostly of short strings use more memory than with
+// strings stored in place. get_string() returns a String reference, which needs that std::string.
 class Json {
  public:
   using Array = std::vector<Json>;
   using Boolean = bool;
   using Integer = int64_t;
   struct Nil {};
-  using Object = std::map<std::string, Json>;
+  class Object;
   using Double = double;
   using String = std::string;
-  using Variant = std::variant<Array, Boolean, Integer, Nil, Object, Double, String>;
 
   Json();
-  Json(Json&& other);
+  Json(Json&& other) noexcept;
   Json(const Json& other);
   explicit Json(const Array& value);
   explicit Json(Array&& value);
@@ -45,7 +78,7 @@ class Json {
   ~Json();
 
   Json& operator=(const Json& other);
-  Json& operator=(Json&& other);
+  Json& operator=(Json&& other) noexcept;
 
   Json& operator=(const Array& value);
   Json& operator=(Array&& value);
@@ -59,10 +92,20 @@ class Json {
   Json& operator=(String&& value);
   Json& operator=(const char* value);
 
+  // copy sharing storage with this value, see the class comment
+  Json share() const;
+
+  // Inequality of arrays, objects and strings with cached hashes is found without visiting elements
   bool operator==(const Json& other) const;
   bool operator!=(const Json& other) const;
   bool operator<(const Json& other) const;
 
+  // Structural hash, equal values have equal hashes. Cached in arrays, objects and strings, the
+  // cache is reset by non-const accessors. Values which handed out references through non-const
+  // accessors (see share()) are not cached, as a change through a reference would not reset it:
+  // such values are hashed again by every call, reusing the caches of their unmodified children.
+  uint64_t hash() const;
+
   bool is_array() const;
   bool is_bool() const;
   bool is_integer() const;
@@ -84,6 +127,17 @@ class Json {
   Object& get_object();
   String& get_string();
 
+  // Arrays of only integers or only doubles are parsed into packed storage, these return it
+  // and nullptr for other values. Const access to elements of packed arrays builds a cached
+  // generic copy, non-const access converts the array to generic storage.
+  const std::vector<Integer>* packed_integers() const;
+  const std::vector<Double>* packed_doubles() const;
+
+  // Parsed integers out of Integer range keep their decimal text, which this returns (nullptr for
+  // other values). They are integers, get_integer() throws JsonGetException for them, get_number()
+  // converts the text and serialization writes it unchanged.
+  const String* big_integer() const;
+
   Double& get_double();
 
   Boolean& get_bool();
@@ -111,36 +165,246 @@ class Json {
   Json& insert(const std::string key, Json&& value);
 
   friend std::istream& JSON::operator>>(std::istream& in, Json& json);
+  friend Json JSON::parse(std::istream& in, const ParseOptions& options);
+  friend class Interner;
   void pretty_print(std::ostream& out, int tab_size=2, int offset=0, bool first_line_offset=true) const;
+  // plain text, without console styles
+  void pretty_print(Writer& out, int tab_size=2, int offset=0, bool first_line_offset=true) const;
+  // Same output as Writer::write_json(). The text of the value and of nested arrays and objects
+  // at least `min_size` bytes long is kept, and later calls copy it instead of serializing again.
+  // Texts of nested values are referenced, not copied. Non-const accessors drop the texts of the
+  // modified value and of its parents, so after a change only that path is serialized again.
+  // Like for hash(), the texts of values opened to modification by non-const accessors are not
+  // kept, such values are serialized again by every call, reusing the texts of their children.
+  void write_cached(Writer& out, size_t min_size = 1024) const;
  private:
-  using ObjectMimic = std::aligned_union_t<0, Object>;
-
-  static_assert(sizeof(ObjectMimic) == sizeof(Object), "");
-  static_assert(alignof(ObjectMimic) == alignof(Object), "");
-
-  std::aligned_union_t<0,
-                       std::variant<Array,        // 0
-                                    Boolean,      // 1
-                                    Integer,      // 2
-                                    Nil,          // 3
-                                    ObjectMimic,  // 4
-                                    Double,       // 5
-                                    String        // 6
-                                    >>
-      m_value;
-
-  const Variant& variant() const;
-  Variant& variant();
-
-  void readArray(std::istream& in);
+  // order of types is used by operator< for values of different types
+  enum class Type : uint8_t { Array, Boolean, Integer, Nil, Object, Double, String };
+
+  struct Block;
+  template <class T>
+  struct Shared;
+  struct PackedArray;
+  // serialized text for write_cached()
+  struct TextCache;
+  class TextWriter;
+
+  // scalars are stored in place, containers and strings in shared blocks
+  union Value {
+    Shared<Array>* array;
+    PackedArray* packed;
+    Boolean boolean;
+    Integer integer;
+    Shared<Object>* object;
+    Double number;
+    Shared<String>* string;
+  };
+
+  // heap block of arrays, objects and strings, nullptr for scalars
+  Block* block() const;
+  // drops reference to the block, values of any depth are freed without recursion
+  void destroy();
+  // deletes the unshared block, its unshared arrays and objects are moved to `pending`
+  void free_block(std::vector<Json>& pending);
+  // copies block shared with other values, before non-const access, and marks the value exposed
+  void detach();
+  // converts packed array to generic storage
+  void unpack();
+
+  // Comparison of values with already interned children, which are compared by block address
+  size_t shallow_hash() const;
+  bool shallow_equal(const Json& other) const;
+  bool same_node(const Json& other) const;
+  // id of the Interner holding this block, 0 if none
+  uint32_t interned() const;
+  void set_interned(uint32_t id);
+  // writes an array or object without its own cached text, nested texts at least `min_size`
+  // bytes long are cached and referenced
+  void write_text(TextWriter& out, size_t min_size) const;
+
+  Value m_value;
+  Type m_type;
+  // Array type with PackedArray payload
+  bool m_packed = false;
+  // Integer type with Shared<String> payload, see big_integer()
+  bool m_big = false;
+  // references into the block were handed out by non-const accessors of this value or of
+  // a child, share() copies the block
+  bool m_exposed = false;
+
+  void read(std::istream& in, const ParseOptions& options);
+  void readArray(std::istream& in, const ParseOptions& options);
   void readTrue(std::istream& in);
   void readFalse(std::istream& in);
   void readNumber(std::istream& in, char c);
   void readNull(std::istream& in);
-  void readObject(std::istream& in);
+  void readObject(std::istream& in, const ParseOptions& options);
   void readString(std::istream& in);
 };
 
+// Key/value pairs in a vector of pointers to pooled nodes.
+//
+// By default pairs are sorted by key, iteration is in key order like std::map and lookup is
+// a binary search. Inserting or erasing a single key moves the tail of the pointer vector,
+// parsed objects are sorted once when complete.
+//
+// Insertion ordered objects keep pairs in the order they were added, so they serialize
+// with the source key order. Objects with at least `hash_threshold` keys get an
+// open-addressing hash index, smaller ones are scanned. Erasing a key rebuilds the index.
+//
+// Each pair has its own node, so like with std::map references and pointers to pairs and
+// values stay valid until the pair is erased: `json("a") = json("b")` is safe. Iterators are
+// positions in the pointer vector, they are invalidated by emplace() of a new key, erase()
+// and clear(), and by sorting when a parsed object is complete.
+//
+// Objects are equal if they have the same pairs regardless of order.
+// Keys must not be modified through iterators.
+class Json::Object {
+ public:
+  using key_type = std::string;
+  using mapped_type = Json;
+  using value_type = std::pair<std::string, Json>;
+  using size_type = size_t;
+
+  template <class Value>
+  class Iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Object::value_type;
+    using difference_type = ptrdiff_t;
+    using pointer = Value*;
+    using reference = Value&;
+
+    Iterator() = default;
+    // iterator converts to const_iterator
+    template <class Other, typename = std::enable_if_t<std::is_same_v<const Other, Value>>>
+    Iterator(const Iterator<Other>& other) : m_pos(other.m_pos) {}
+
+    reference operator*() const { return **m_pos; }
+    pointer operator->() const { return *m_pos; }
+    reference operator[](difference_type n) const { return *m_pos[n]; }
+
+    Iterator& operator++() {
+      ++m_pos;
+      return *this;
+    }
+    Iterator operator++(int) { return Iterator(m_pos++); }
+    Iterator& operator--() {
+      --m_pos;
+      return *this;
+    }
+    Iterator operator--(int) { return Iterator(m_pos--); }
+    Iterator& operator+=(difference_type n) {
+      m_pos += n;
+      return *this;
+    }
+    Iterator& operator-=(difference_type n) {
+      m_pos -= n;
+      return *this;
+    }
+
+    friend Iterator operator+(Iterator it, difference_type n) { return it += n; }
+    friend Iterator operator+(difference_type n, Iterator it) { return it += n; }
+    friend Iterator operator-(Iterator it, difference_type n) { return it -= n; }
+    friend difference_type operator-(const Iterator& a, const Iterator& b) { return a.m_pos - b.m_pos; }
+    friend bool operator==(const Iterator& a, const Iterator& b) { return a.m_pos == b.m_pos; }
+    friend bool operator!=(const Iterator& a, const Iterator& b) { return a.m_pos != b.m_pos; }
+    friend bool operator<(const Iterator& a, const Iterator& b) { return a.m_pos < b.m_pos; }
+    friend bool operator>(const Iterator& a, const Iterator& b) { return a.m_pos > b.m_pos; }
+    friend bool operator<=(const Iterator& a, const Iterator& b) { return a.m_pos <= b.m_pos; }
+    friend bool operator>=(const Iterator& a, const Iterator& b) { return a.m_pos >= b.m_pos; }
+
+   private:
+    friend class Object;
+    template <class>
+    friend class Iterator;
+
+    explicit Iterator(Object::value_type* const* pos) : m_pos(pos) {}
+
+    Object::value_type* const* m_pos = nullptr;
+  };
+
+  using iterator = Iterator<value_type>;
+  using const_iterator = Iterator<const value_type>;
+
+  enum class Order : uint8_t { Sorted, Insertion };
+  static constexpr size_t hash_threshold = 16;
+
+  Object() = default;
+  explicit Object(Order order) : m_order(order) {}
+  // for duplicate keys the last value wins
+  Object(std::initializer_list<value_type> items, Order order = Order::Sorted);
+  Object(const Object& other);
+  Object(Object&& other) noexcept;
+  Object& operator=(const Object& other);
+  Object& operator=(Object&& other) noexcept;
+  ~Object() { clear(); }
+
+  Order order() const { return m_order; }
+
+  iterator begin() { return iterator(m_items.data()); }
+  iterator end() { return iterator(m_items.data() + m_items.size()); }
+  const_iterator begin() const { return const_iterator(m_items.data()); }
+  const_iterator end() const { return const_iterator(m_items.data() + m_items.size()); }
+
+  size_t size() const { return m_items.size(); }
+  bool empty() const { return m_items.empty(); }
+  void reserve(size_t size) { m_items.reserve(size); }
+  void clear();
+
+  iterator find(std::string_view key) {
+    if (m_order == Order::Insertion) {
+      return find_unsorted(key);
+    }
+    auto it = lower_bound(key);
+    return it != end() && it->first == key ? it : end();
+  }
+  const_iterator find(std::string_view key) const { return const_cast<Object*>(this)->find(key); }
+
+  size_t count(std::string_view key) const { return find(key) != end(); }
+
+  // throws std::out_of_range
+  Json& at(std::string_view key);
+  const Json& at(std::string_view key) const { return const_cast<Object*>(this)->at(key); }
+
+  Json& operator[](std::string key) { return emplace(std::move(key), Json()).first->second; }
+
+  // does nothing if the key exists
+  std::pair<iterator, bool> emplace(std::string key, Json value);
+  std::pair<iterator, bool> insert(value_type item) { return emplace(std::move(item.first), std::move(item.second)); }
+
+  iterator erase(const_iterator pos);
+  size_t erase(std::string_view key);
+
+  bool operator==(const Object& other) const;
+  bool operator!=(const Object& other) const { return !(*this == other); }
+  // compares pairs in key order
+  bool operator<(const Object& other) const;
+
+ private:
+  friend class Json;
+
+  iterator lower_bound(std::string_view key) {
+    return iterator(std::lower_bound(m_items.data(), m_items.data() + m_items.size(), key,
+                                     [](const value_type* item, std::string_view key) { return item->first < key; }));
+  }
+  iterator find_unsorted(std::string_view key);
+  // pooled node, not checked for duplicates
+  value_type& append(std::string key, Json value);
+  static void free_node(value_type* item);
+  // for objects not smaller than hash_threshold
+  void index_last();
+  void rebuild_index();
+  // sorts items appended without order, for duplicate keys the last one is kept
+  void sort_unique();
+
+  // owned nodes
+  std::vector<value_type*> m_items;
+  // positions + 1 of items by key hash, 0 for empty slots, size is a power of two
+  std::vector<uint32_t> m_index;
+  Order m_order = Order::Sorted;
+};
+
 bool operator==(const Json::Nil&, const Json::Nil&);
 bool operator!=(const Json::Nil&, const Json::Nil&);
 bool operator<(const Json::Nil&, const Json::Nil&);
@@ -171,3 +435,8 @@ Json operator ""_json(const char*, size_t);
 }
 
 }
+
+template <>
+struct std::hash<JSON::Json> {
+  size_t operator()(const JSON::Json& json) const { return json.hash(); }
+};
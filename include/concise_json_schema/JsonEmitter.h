@@ -0,0 +1,52 @@
+#pragma once
+
+#include "JsonWriter.h"
+
+#include <string_view>
+#include <vector>
+
+namespace JSON {
+
+// Writes Json tokens directly to Writer without building a Json tree.
+//
+//   Emitter emitter(writer);
+//   emitter.begin_object().key("x").value(1).key("y").begin_array().value(true).end_array().end_object();
+//
+// Commas are placed automatically. Unbalanced closing brackets are always
+// reported with JsonException, misplaced keys and values only unless NDEBUG
+// is defined.
+class Emitter {
+ public:
+  explicit Emitter(Writer& out);
+
+  Emitter& begin_object();
+  Emitter& end_object();
+  Emitter& begin_array();
+  Emitter& end_array();
+  Emitter& key(std::string_view name);
+
+  Emitter& value(Json::Nil);
+  Emitter& value(Json::Boolean value);
+  Emitter& value(int value);
+  Emitter& value(Json::Integer value);
+  Emitter& value(Json::Double value);
+  Emitter& value(std::string_view value);
+  Emitter& value(const char* value);
+  Emitter& value(const Json& json);
+
+  // number of open arrays and objects
+  size_t depth() const { return m_stack.size(); }
+
+  void flush() { m_out.flush(); }
+
+ private:
+  void before_value();
+  void before_close(char open);
+
+  Writer& m_out;
+  std::vector<char> m_stack;
+  bool m_need_comma = false;
+  bool m_after_key = false;
+};
+
+}
@@ -17,6 +17,21 @@ class JSONParseException : public JsonException {
  public:
   JSONParseException(const std::string& what);
   JSONParseException(const char* what);
+  JSONParseException(const JSONParseException& error, size_t offset, size_t line, size_t column);
+
+  // position is known only if input stream is seekable
+  bool has_location() const { return m_line != 0; }
+  // byte offset from beginning of the stream
+  size_t offset() const { return m_offset; }
+  // 1-based
+  size_t line() const { return m_line; }
+  // 1-based, in bytes
+  size_t column() const { return m_column; }
+
+ private:
+  size_t m_offset = 0;
+  size_t m_line = 0;
+  size_t m_column = 0;
 };
 
 class JsonGetException : public JsonException {
@@ -30,4 +45,15 @@ class JSONRangeException : public JsonException {
   JSONRangeException(const Json& ref, const std::string& key);
   JSONRangeException(const Json& ref, size_t index);
 };
+
+class JsonPatchException : public JsonException {
+ public:
+  JsonPatchException(const std::string& what, size_t operation);
+
+  // 0-based index of the failed operation in the patch
+  size_t operation() const { return m_operation; }
+
+ private:
+  size_t m_operation;
+};
 }
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Json.h"
+
+#include <unordered_set>
+
+namespace JSON {
+
+// Hash consing of Json values.
+//
+// Arrays, objects and strings passed through one Interner are deduplicated: structurally equal
+// values share a single storage block, repeated subtrees are stored once, and compare equal by
+// address. Values equal by operator== but written differently (0.0 and -0.0, other key order,
+// packed and generic arrays) keep their own blocks, so that serialization does not change.
+// Interned values are Json::share() copies, so modifying one does not affect the others.
+//
+// Pass the interner in ParseOptions to intern while parsing, or intern() built values.
+// The interner keeps its values alive until clear() or destruction. Not thread-safe.
+class Interner {
+ public:
+  Interner();
+
+  // replaces arrays, objects and strings in `json` by interned equal ones
+  Json& intern(Json& json);
+
+  // number of distinct interned values
+  size_t size() const { return m_values.size(); }
+  // values interned later do not share storage with values interned before
+  void clear();
+
+ private:
+  friend class Json;
+
+  // children of `json` must be interned already
+  void intern_node(Json& json);
+
+  struct Hash {
+    size_t operator()(const Json& json) const;
+  };
+  struct Equal {
+    bool operator()(const Json& a, const Json& b) const;
+  };
+
+  uint32_t m_id;
+  std::unordered_set<Json, Hash, Equal> m_values;
+};
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Json.h"
+
+namespace JSON {
+
+// In-place modification of Json documents.
+//
+// Values are taken from the patch as O(1) Json::share() copies and removed values are moved out,
+// so only the nodes on the patched paths are touched and the cost does not depend on the
+// size of the rest of the document.
+
+// Applies an RFC 6902 JSON Patch, an array of add, remove, replace, move, copy and test
+// operations. Throws JsonPatchException if an operation is malformed, its path does not
+// exist or a test fails; operations applied before are then undone and `json` is unchanged.
+void apply_patch(Json& json, const Json& patch);
+
+// Applies an RFC 7386 JSON Merge Patch: members of patch objects are merged recursively,
+// null members remove keys, any other value replaces the target.
+void apply_merge_patch(Json& json, const Json& patch);
+
+// JSON Patch of add, remove and replace operations which turns `from` into `to`.
+// Subtrees with equal structural hashes are compared and skipped without descending, equal
+// shared ones (e.g. of Json::share() snapshots) in O(1). Objects are compared key by key,
+// changed members of arrays are found by skipping the common prefix and suffix, elements
+// between them are compared by position.
+Json diff(const Json& from, const Json& to);
+
+}
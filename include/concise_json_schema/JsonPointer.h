@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Json.h"
+
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace JSON {
+
+// RFC 6901 JSON Pointer, e.g. "/a/b/3/c".
+//
+// The text is parsed once into reference tokens, array indices are converted up front.
+// find() and get() resolve the pointer with no allocation and report a pointer that does not
+// match the document by nullptr or std::nullopt, instead of throwing like chained operator()
+// and operator[].
+class JsonPointer {
+ public:
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  struct Token {
+    // unescaped, `~0` and `~1` are replaced by `~` and `/`
+    std::string key;
+    // array index of the token, npos if it is not a valid one (e.g. "-" or "01")
+    size_t index;
+
+    bool operator==(const Token& other) const { return key == other.key; }
+    bool operator!=(const Token& other) const { return key != other.key; }
+  };
+
+  // whole document
+  JsonPointer() = default;
+  // throws JSONParseException if `text` is neither empty nor starts with '/', or has a bad escape
+  explicit JsonPointer(std::string_view text);
+
+  // Finds the referenced value, nullptr if there is none. Objects are searched by key,
+  // arrays by index, scalars on the path never match. Paths through a packed array are
+  // rejected on its packed storage, but pointing at one of its elements needs a node,
+  // so const access then builds the cached generic copy once. The non-const version
+  // copies shared blocks along the path like other non-const accessors.
+  const Json* find(const Json& json) const;
+  Json* find(Json& json) const;
+  // Like the const find(), but returns the value by share(), std::nullopt if there is
+  // none. Elements of packed arrays are read from the packed storage with no allocation.
+  std::optional<Json> get(const Json& json) const;
+
+  const std::vector<Token>& tokens() const { return m_tokens; }
+  size_t size() const { return m_tokens.size(); }
+  bool empty() const { return m_tokens.empty(); }
+  const Token& back() const { return m_tokens.back(); }
+
+  // pointer without the last token, the whole document for the whole document
+  JsonPointer parent() const;
+  JsonPointer& push_back(std::string key);
+  JsonPointer& push_back(size_t index);
+  void pop_back() { m_tokens.pop_back(); }
+
+  bool operator==(const JsonPointer& other) const { return m_tokens == other.m_tokens; }
+  bool operator!=(const JsonPointer& other) const { return m_tokens != other.m_tokens; }
+
+ private:
+  std::vector<Token> m_tokens;
+};
+
+// escaped text of the pointer, "" for the whole document
+std::string to_string(const JsonPointer& pointer);
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+
+namespace JSON {
+
+// Free lists for the heap blocks of Json arrays, objects and strings, and for the nodes of object pairs.
+//
+// Block sizes are rounded up to 16-byte classes. Freed blocks are kept in lists of the freeing
+// thread, up to `pool_max_cached` per class, and reused by its later allocations, so repeated
+// parse/destroy cycles take warm memory instead of going to the global heap. Blocks may be freed
+// on any thread. Element buffers of arrays, pointer vectors of objects and characters of long
+// strings are not pooled, they use the standard allocator.
+
+const size_t pool_max_block_size = 256;
+const size_t pool_max_cached = 1024;
+
+struct PoolStats {
+  // blocks allocated, `reused` of them taken from the free lists
+  size_t allocated = 0;
+  size_t reused = 0;
+  // blocks freed, `kept` of them put to the free lists
+  size_t freed = 0;
+  size_t kept = 0;
+  // blocks in the free lists now and their total size
+  size_t cached = 0;
+  size_t cached_bytes = 0;
+};
+
+// counters of the calling thread
+PoolStats pool_stats();
+
+// Enabled by default. While disabled, blocks are allocated and freed with operator new and delete,
+// blocks already cached stay until trim_pool().
+void set_pool_enabled(bool enabled);
+bool pool_enabled();
+
+// returns blocks cached by the calling thread to the heap
+void trim_pool();
+
+void* pool_allocate(size_t size);
+void pool_deallocate(void* block, size_t size);
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "JsonWriter.h"
+
+#include <string_view>
+#include <vector>
+
+namespace JSON {
+
+// Indented multi-line Json output.
+//
+// Nested values are traversed with an explicit stack, so the depth of the
+// document is not limited by the call stack. Plain output goes straight into
+// the Writer, derived printers may decorate tokens or append notes after values.
+class PrettyPrinter {
+ public:
+  enum class Token { Literal, Number, Key, String };
+
+  explicit PrettyPrinter(Writer& out, int tab_size = 2);
+  virtual ~PrettyPrinter() = default;
+
+  void print(const Json& json, int offset = 0, bool first_line_offset = true);
+
+ protected:
+  // Key and String tokens are passed unescaped
+  virtual void token(Token kind, std::string_view text);
+  // called when `json` printed at indentation `offset` is complete
+  virtual void after_value(const Json& /*json*/, int /*offset*/) {}
+  // Elements of packed arrays are printed from the packed storage, after_value() gets a temporary
+  // node for them. Returning true prints `array` through get_array() instead, which builds its
+  // cached generic copy, for printers that look elements up by address.
+  virtual bool element_nodes(const Json& /*array*/) const { return false; }
+
+  void indent(size_t width);
+
+  Writer& m_out;
+  int m_tab_size;
+
+ private:
+  struct Frame {
+    const Json* json;
+    int offset;
+    size_t index;
+    size_t key_width;
+    Json::Object::const_iterator iter;
+  };
+
+  void begin_value(const Json& json, int offset);
+  const Json* element(const Json& array, size_t index);
+  void key(const std::string& name, size_t width);
+
+  std::vector<Frame> m_stack;
+  // current element of a packed array
+  Json m_element;
+};
+
+// Pretty printer for std::ostream which highlights tokens with ConsoleStyle
+class ConsolePrettyPrinter : public PrettyPrinter {
+ public:
+  explicit ConsolePrettyPrinter(std::ostream& out, int tab_size = 2);
+
+ protected:
+  void token(Token kind, std::string_view text) override;
+
+  std::ostream& m_stream;
+  StreamWriter m_writer;
+};
+
+}
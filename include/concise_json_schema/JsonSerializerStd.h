@@ -8,6 +8,7 @@
 #include <type_traits>
 #include <vector>
 #include <optional>
+#include <variant>
 #include "JsonException.h"
 
 namespace JSON{
@@ -75,6 +76,22 @@ struct JsonSerializer<std::pair<T1, T2>> {
 template <typename T>
 struct JsonSerializer<std::vector<T>> {
   static void deserialize(const Json& json, std::vector<T>& v) {
+    // packed arrays are copied in bulk, with the conversions of the element serializers
+    if constexpr (std::is_floating_point<T>::value) {
+      if (auto packed = json.packed_doubles()) {
+        v.assign(packed->begin(), packed->end());
+        return;
+      }
+      if (auto packed = json.packed_integers()) {
+        v.assign(packed->begin(), packed->end());
+        return;
+      }
+    } else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+      if (auto packed = json.packed_integers()) {
+        v.assign(packed->begin(), packed->end());
+        return;
+      }
+    }
     v.clear();
     for (auto& x : json) {
       T t;
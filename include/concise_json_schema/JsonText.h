@@ -0,0 +1,36 @@
+#pragma once
+
+#include "JsonPointer.h"
+#include "JsonWriter.h"
+
+#include <iostream>
+#include <string_view>
+
+namespace JSON {
+
+// Operations on JSON text which do not build a Json tree.
+//
+// Reformatting streams tokens from input to output in constant memory: whitespace
+// is normalized, `/* */` comments are dropped, strings, numbers and literals are
+// copied verbatim. Only brackets, strings and comments are checked, other syntax
+// errors are passed through. Errors are reported with JSONParseException.
+
+// removes all insignificant whitespace
+void minify(std::istream& in, Writer& out);
+void minify(std::string_view text, Writer& out);
+
+// one value or key per line, nested values indented by `tab_size`
+void reindent(std::istream& in, Writer& out, int tab_size = 2);
+void reindent(std::string_view text, Writer& out, int tab_size = 2);
+
+// Value at `pointer` in `text`, found by skipping over preceding values without parsing them.
+// Empty if there is no such value. For duplicate keys the first one is found. Only the scanned
+// part of the text is checked.
+std::string_view find_value(std::string_view text, const JsonPointer& pointer);
+
+// Replaces the text of the value at `pointer` by `value` (which is inserted as is) or by serialized
+// `value`, the rest of the text is kept byte for byte. Returns false if there is no such value.
+bool replace_value(std::string& text, const JsonPointer& pointer, std::string_view value);
+bool replace_value(std::string& text, const JsonPointer& pointer, const Json& value);
+
+}
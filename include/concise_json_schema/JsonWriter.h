@@ -0,0 +1,190 @@
+#pragma once
+
+#include "Json.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct iovec;
+
+namespace JSON {
+
+// Buffered output for Json serialization.
+//
+// Derived writers provide a window [m_pos, m_end) of writable memory,
+// the fast path only copies into it, the virtual overflow() is called
+// when the window is exhausted.
+class Writer {
+ public:
+  Writer() = default;
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+  virtual ~Writer() = default;
+
+  void put(char c) {
+    if (m_pos == m_end) {
+      overflow(1);
+    }
+    *m_pos++ = c;
+  }
+
+  void append(const char* data, size_t size) {
+    if (size_t(m_end - m_pos) < size) {
+      append_large(data, size);
+      return;
+    }
+    std::memcpy(m_pos, data, size);
+    m_pos += size;
+  }
+
+  void append(const std::string& s) { append(s.data(), s.size()); }
+
+  // returns at least `size` writable bytes, used part must be committed
+  char* reserve(size_t size) {
+    if (size_t(m_end - m_pos) < size) {
+      overflow(size);
+    }
+    return m_pos;
+  }
+  void commit(char* end) { m_pos = end; }
+
+  void write_integer(Json::Integer value);
+  void write_double(Json::Double value);
+  // quoted and escaped
+  void write_string(std::string_view value);
+  void write_json(const Json& json);
+  // `count` spaces, used for indentation
+  void write_spaces(size_t count);
+
+  virtual void flush() {}
+
+ protected:
+  // must provide at least `size` writable bytes
+  virtual void overflow(size_t size) = 0;
+  // called when `size` bytes do not fit into current window, the data must be copied, it may be
+  // a temporary buffer
+  virtual void append_large(const char* data, size_t size);
+  // called by write_string() for string runs not shorter than m_ref_threshold, the data stays
+  // valid until flush()
+  virtual void append_ref(const char* data, size_t size) { append(data, size); }
+
+  char* m_pos = nullptr;
+  char* m_end = nullptr;
+  size_t m_ref_threshold = SIZE_MAX;
+};
+
+// Appends to std::string, string content is valid after flush() or destruction of the writer
+class StringWriter : public Writer {
+ public:
+  explicit StringWriter(std::string& out);
+  ~StringWriter() override;
+  void flush() override;
+
+ protected:
+  void overflow(size_t size) override;
+
+ private:
+  std::string& m_out;
+};
+
+// Writes to std::ostream in chunks, flushes on destruction
+class StreamWriter : public Writer {
+ public:
+  explicit StreamWriter(std::ostream& out);
+  ~StreamWriter() override;
+  void flush() override;
+
+ protected:
+  void overflow(size_t size) override;
+  void append_large(const char* data, size_t size) override;
+
+ private:
+  std::ostream& m_out;
+  char m_buffer[8192];
+};
+
+// Writes to a file descriptor with writev(), without assembling the output in one contiguous buffer.
+//
+// Output is collected in fixed-size chunks, long string values are referenced in place rather than copied.
+// Pending data is written when too many chunks are filled and on flush(), so the serialized Json
+// must stay alive and unmodified until flush() returns. Errors are reported with std::system_error.
+class FdWriter : public Writer {
+ public:
+  explicit FdWriter(int fd, size_t chunk_size = 64 * 1024, size_t max_chunks = 16);
+  ~FdWriter() override;
+  void flush() override;
+
+ protected:
+  void overflow(size_t size) override;
+  void append_ref(const char* data, size_t size) override;
+
+ private:
+  void close_piece();
+  void next_chunk();
+
+  int m_fd;
+  size_t m_chunk_size;
+  size_t m_max_chunks;
+  std::vector<std::unique_ptr<char[]>> m_chunks;
+  size_t m_chunk = 0;
+  std::vector<iovec> m_pieces;
+  char* m_piece_begin = nullptr;
+};
+
+// Computes 128-bit hash (MurmurHash3 x64_128) of written bytes without keeping them
+class HashWriter : public Writer {
+ public:
+  struct Hash128 {
+    uint64_t low;
+    uint64_t high;
+    bool operator==(const Hash128& other) const { return low == other.low && high == other.high; }
+    bool operator!=(const Hash128& other) const { return !(*this == other); }
+  };
+
+  explicit HashWriter(uint64_t seed = 0);
+  // hash of all bytes written so far, more bytes may follow
+  Hash128 digest() const;
+
+ protected:
+  void overflow(size_t size) override;
+
+ private:
+  uint64_t m_h1;
+  uint64_t m_h2;
+  uint64_t m_length = 0;
+  // multiple of the 16-byte block
+  char m_buffer[4096];
+};
+
+// Canonical form: no whitespace, object keys sorted, strings escaped as by write_json(), integers in
+// decimal and doubles in the shortest round-trip form, which always has '.' or an exponent, so 1 and
+// 1.0 differ. -0.0 is written as 0.0, values equal by Json::operator== have the same canonical form.
+void write_canonical(Writer& out, const Json& json);
+std::string to_canonical_string(const Json& json);
+// hash of to_canonical_string(json), without building the string
+HashWriter::Hash128 canonical_hash(const Json& json, uint64_t seed = 0);
+
+// Shortest representation which reads back to the same double.
+// Values in range [1e-5, 1e5] are written in fixed notation (always with a fraction part), others in scientific.
+// Writes at most max_double_size characters, returns end of the written range
+const size_t max_double_size = 32;
+char* format_double(char* first, Json::Double value);
+
+// appends code point `code` encoded in UTF-8
+void append_utf8(std::string& out, uint32_t code);
+
+// Same output as out.write_json(json). Elements of arrays and objects with at least `min_size` elements
+// are serialized into separate buffers, which are then appended in order. All such containers, nested
+// ones included, share one pool of `threads` threads (0 - hardware concurrency). The buffers are copied
+// into `out` before the call returns, so `out` may be flushed later.
+void write_json_parallel(Writer& out, const Json& json, size_t threads = 0, size_t min_size = 4096);
+
+// exact length of to_string(json)
+size_t serialized_size(const Json& json);
+
+}
@@ -24,6 +24,8 @@ class SchemaMatchResult {
     MatchError(const Json& json, const std::string& what, MatchError&& matchError);
     // precondition: corresponding Schema and Json MUST still exist (otherwise you'll get SEGFAULT)
     void pretty_wordy_print(std::ostream& out, int tab_size=2, int offset=0) const;
+    // plain text, without console styles
+    void pretty_wordy_print(Writer& out, int tab_size=2, int offset=0) const;
     const Json* json;
     const Schema* schema=nullptr;
     std::vector<MatchError> nested;
@@ -1,15 +1,23 @@
 #include "concise_json_schema/Json.h"
 #include "concise_json_schema/JsonException.h"
-#include "console_style/ConsoleSyle.h"
+#include "concise_json_schema/JsonInterner.h"
+#include "concise_json_schema/JsonPool.h"
+#include "concise_json_schema/JsonPrettyPrinter.h"
+#include "concise_json_schema/JsonWriter.h"
 
 #include <algorithm>
+#include <atomic>
+#include <charconv>
 #include <cmath>
-#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
 
 using namespace JSON;
 
-using std::get;
-
 
 namespace {
 
@@ -56,129 +64,1079 @@ void read_non_space_or_throw(std::istream& in, char& c, bool skip_comments = tru
   read_non_space(in, c, skip_comments);
   throw_if_bad(in);
 }
+
+uint32_t read_hex4(std::istream& in) {
+  char data[4];
+  in.read(data, 4);
+  throw_if_bad(in);
+  uint32_t code = 0;
+  for (char c : data) {
+    code <<= 4;
+    if (c >= '0' && c <= '9') {
+      code |= c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      code |= c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      code |= c - 'A' + 10;
+    } else {
+      throw JSONParseException("bad `\\u` escape");
+    }
+  }
+  return code;
+}
+
+// reads string after opening quote, escape sequences are decoded
+void read_string(std::istream& in, std::string& value) {
+  char c;
+  while (true) {
+    in.read(&c, 1);
+    throw_if_bad(in);
+    if (c == '"') {
+      return;
+    }
+    if (c != '\\') {
+      value += c;
+      continue;
+    }
+    in.read(&c, 1);
+    throw_if_bad(in);
+    switch (c) {
+      case '"':
+      case '\\':
+      case '/':
+        value += c;
+        break;
+      case 'b':
+        value += '\b';
+        break;
+      case 'f':
+        value += '\f';
+        break;
+      case 'n':
+        value += '\n';
+        break;
+      case 'r':
+        value += '\r';
+        break;
+      case 't':
+        value += '\t';
+        break;
+      case 'u': {
+        uint32_t code = read_hex4(in);
+        if (code >= 0xD800 && code < 0xDC00 && in.peek() == '\\') {
+          in.read(&c, 1);
+          if (in.peek() == 'u') {
+            in.read(&c, 1);
+            uint32_t low = read_hex4(in);
+            if (low >= 0xDC00 && low < 0xE000) {
+              code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            } else {
+              append_utf8(value, code);
+              code = low;
+            }
+          } else {
+            in.unget();
+          }
+        }
+        append_utf8(value, code);
+        break;
+      }
+      default:
+        throw JSONParseException("bad escape sequence `\\" + std::string(1, c) + "`");
+    }
+  }
+}
+
+// Parser does not count lines on the fly, position of the error is
+// restored from the stream pointer and lines are counted only here
+JSONParseException locate(std::istream& in, const JSONParseException& error) {
+  auto state = in.rdstate();
+  in.clear();
+  auto pos = in.tellg();
+  if (pos == std::istream::pos_type(-1)) {
+    in.setstate(state);
+    return error;
+  }
+  size_t consumed = static_cast<size_t>(pos);
+  // on EOF point past the last character, otherwise to the last consumed one
+  size_t offset = (state & std::ios::eofbit) || consumed == 0 ? consumed : consumed - 1;
+
+  size_t line = 1;
+  size_t line_begin = 0;
+  in.seekg(0);
+  char buffer[4096];
+  for (size_t done = 0; done < offset && in.good();) {
+    in.read(buffer, std::min(sizeof(buffer), offset - done));
+    size_t n = static_cast<size_t>(in.gcount());
+    for (size_t i = 0; i < n; ++i) {
+      if (buffer[i] == '\n') {
+        ++line;
+        line_begin = done + i + 1;
+      }
+    }
+    done += n;
+    if (n == 0) {
+      break;
+    }
+  }
+  in.clear();
+  in.seekg(pos);
+  in.setstate(state);
+  return JSONParseException(error, offset, line, offset - line_begin + 1);
+}
+}
+
+Json::Object::Object(std::initializer_list<value_type> items, Order order) : m_order(order) {
+  if (order == Order::Sorted) {
+    m_items.reserve(items.size());
+    for (auto& item : items) {
+      append(item.first, item.second);
+    }
+    sort_unique();
+    return;
+  }
+  for (auto& item : items) {
+    (*this)[item.first] = item.second;
+  }
+}
+
+Json::Object::Object(const Object& other) : m_index(other.m_index), m_order(other.m_order) {
+  m_items.reserve(other.size());
+  try {
+    for (auto& item : other) {
+      append(item.first, item.second);
+    }
+  } catch (...) {
+    clear();
+    throw;
+  }
+}
+
+Json::Object::Object(Object&& other) noexcept
+    : m_items(std::move(other.m_items)), m_index(std::move(other.m_index)), m_order(other.m_order) {}
+
+Json::Object& Json::Object::operator=(const Object& other) {
+  if (this != &other) {
+    *this = Object(other);
+  }
+  return *this;
+}
+
+Json::Object& Json::Object::operator=(Object&& other) noexcept {
+  if (this != &other) {
+    clear();
+    m_items.swap(other.m_items);
+    m_index.swap(other.m_index);
+    m_order = other.m_order;
+  }
+  return *this;
+}
+
+void Json::Object::clear() {
+  for (auto item : m_items) {
+    free_node(item);
+  }
+  m_items.clear();
+  m_index.clear();
+}
+
+Json::Object::value_type& Json::Object::append(std::string key, Json value) {
+  // push_back below must not throw after the node is allocated
+  if (m_items.size() == m_items.capacity()) {
+    m_items.reserve(std::max(size_t(4), 2 * m_items.size()));
+  }
+  void* node = pool_allocate(sizeof(value_type));
+  m_items.push_back(new (node) value_type(std::move(key), std::move(value)));
+  return *m_items.back();
+}
+
+void Json::Object::free_node(value_type* item) {
+  item->~value_type();
+  pool_deallocate(item, sizeof(value_type));
+}
+
+Json& Json::Object::at(std::string_view key) {
+  auto it = find(key);
+  if (it == end()) {
+    throw std::out_of_range("Json::Object::at");
+  }
+  return it->second;
+}
+
+std::pair<Json::Object::iterator, bool> Json::Object::emplace(std::string key, Json value) {
+  if (m_order == Order::Insertion) {
+    auto it = find_unsorted(key);
+    if (it != end()) {
+      return {it, false};
+    }
+    append(std::move(key), std::move(value));
+    index_last();
+    return {end() - 1, true};
+  }
+  auto it = lower_bound(key);
+  if (it != end() && it->first == key) {
+    return {it, false};
+  }
+  size_t pos = it - begin();
+  append(std::move(key), std::move(value));
+  std::rotate(m_items.begin() + pos, m_items.end() - 1, m_items.end());
+  return {begin() + pos, true};
+}
+
+Json::Object::iterator Json::Object::erase(const_iterator pos) {
+  size_t offset = pos - begin();
+  free_node(m_items[offset]);
+  m_items.erase(m_items.begin() + offset);
+  if (!m_index.empty()) {
+    rebuild_index();
+  }
+  return begin() + offset;
+}
+
+size_t Json::Object::erase(std::string_view key) {
+  auto it = find(key);
+  if (it == end()) {
+    return 0;
+  }
+  erase(it);
+  return 1;
+}
+
+bool Json::Object::operator==(const Object& other) const {
+  if (m_order == Order::Sorted && other.m_order == Order::Sorted) {
+    return size() == other.size() && std::equal(begin(), end(), other.begin());
+  }
+  if (size() != other.size()) {
+    return false;
+  }
+  for (auto& item : *this) {
+    auto it = other.find(item.first);
+    if (it == other.end() || it->second != item.second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Json::Object::operator<(const Object& other) const {
+  if (m_order == Order::Sorted && other.m_order == Order::Sorted) {
+    return std::lexicographical_compare(begin(), end(), other.begin(), other.end());
+  }
+  auto sorted = [](const Object& object) {
+    std::vector<const value_type*> items(object.m_items.begin(), object.m_items.end());
+    if (object.m_order == Order::Insertion) {
+      std::sort(items.begin(), items.end(), [](auto a, auto b) { return a->first < b->first; });
+    }
+    return items;
+  };
+  auto a = sorted(*this);
+  auto b = sorted(other);
+  return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
+                                      [](auto x, auto y) { return *x < *y; });
+}
+
+Json::Object::iterator Json::Object::find_unsorted(std::string_view key) {
+  if (m_index.empty()) {
+    return std::find_if(begin(), end(), [&](const value_type& item) { return item.first == key; });
+  }
+  size_t mask = m_index.size() - 1;
+  for (size_t slot = std::hash<std::string_view>()(key) & mask; m_index[slot] != 0; slot = (slot + 1) & mask) {
+    auto it = begin() + (m_index[slot] - 1);
+    if (it->first == key) {
+      return it;
+    }
+  }
+  return end();
+}
+
+void Json::Object::index_last() {
+  if (m_items.size() < hash_threshold) {
+    return;
+  }
+  // load factor at most 1/2
+  if (m_index.size() < 2 * m_items.size()) {
+    rebuild_index();
+    return;
+  }
+  size_t mask = m_index.size() - 1;
+  size_t slot = std::hash<std::string_view>()(m_items.back()->first) & mask;
+  while (m_index[slot] != 0) {
+    slot = (slot + 1) & mask;
+  }
+  m_index[slot] = uint32_t(m_items.size());
+}
+
+void Json::Object::rebuild_index() {
+  m_index.clear();
+  if (m_order != Order::Insertion || m_items.size() < hash_threshold) {
+    return;
+  }
+  size_t capacity = 2 * hash_threshold;
+  while (capacity < 4 * m_items.size()) {
+    capacity *= 2;
+  }
+  m_index.assign(capacity, 0);
+  size_t mask = capacity - 1;
+  for (size_t i = 0; i < m_items.size(); ++i) {
+    size_t slot = std::hash<std::string_view>()(m_items[i]->first) & mask;
+    while (m_index[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    m_index[slot] = uint32_t(i + 1);
+  }
+}
+
+void Json::Object::sort_unique() {
+  auto less = [](const value_type* a, const value_type* b) { return a->first < b->first; };
+  auto not_less = [](const value_type* a, const value_type* b) { return !(a->first < b->first); };
+  if (std::adjacent_find(m_items.begin(), m_items.end(), not_less) == m_items.end()) {
+    return;
+  }
+  std::stable_sort(m_items.begin(), m_items.end(), less);
+  auto out = m_items.begin();
+  for (auto it = m_items.begin(); it != m_items.end();) {
+    auto last = it;
+    while (last + 1 != m_items.end() && last[1]->first == (*it)->first) {
+      ++last;
+    }
+    for (; it != last; ++it) {
+      free_node(*it);
+    }
+    *out++ = *last;
+    it = last + 1;
+  }
+  m_items.erase(out, m_items.end());
+}
+
+struct Json::TextCache {
+  // cached text of a nested value, inserted at `offset` of `text`
+  struct Part {
+    size_t offset;
+    TextCache* cache;
+  };
+
+  TextCache() = default;
+  TextCache(const TextCache&) = delete;
+
+  // drops a reference to `cache`, and to its parts if it was the last one
+  static void release_all(TextCache* cache);
+
+  void write(Writer& out) const {
+    size_t pos = 0;
+    for (auto& part : parts) {
+      out.append(text.data() + pos, part.offset - pos);
+      part.cache->write(out);
+      pos = part.offset;
+    }
+    out.append(text.data() + pos, text.size() - pos);
+  }
+
+  std::atomic<uint32_t> refs{1};
+  // length of the whole text, with parts
+  size_t size = 0;
+  std::string text;
+  // each holds a reference
+  std::vector<Part> parts;
+};
+
+struct Json::Block {
+  Block() = default;
+  // copy of a block is not shared yet
+  Block(const Block&) {}
+  ~Block() { reset_text(); }
+
+  // blocks of all types are pooled, they are always deleted through their own type
+  static void* operator new(size_t size) { return pool_allocate(size); }
+  static void operator delete(void* block, size_t size) { pool_deallocate(block, size); }
+
+  void reset_text();
+
+  std::atomic<uint32_t> refs{1};
+  // id of the Interner holding the block, its content is not modified while set
+  uint32_t interned = 0;
+  // 0 if not computed yet
+  std::atomic<uint64_t> hash{0};
+  // nullptr if not written by write_cached() since the last change
+  std::atomic<TextCache*> text{nullptr};
+};
+
+template <class T>
+struct Json::Shared : Block {
+  template <class Arg>
+  explicit Shared(Arg&& arg) : value(std::forward<Arg>(arg)) {}
+  Shared(const Shared&) = default;
+
+  T value;
+};
+
+struct Json::PackedArray : Block {
+  explicit PackedArray(Type element) : element(element) {}
+  PackedArray(const PackedArray& other)
+      : Block(other), element(other.element), integers(other.integers), doubles(other.doubles) {}
+  ~PackedArray() { delete generic.load(); }
+
+  size_t size() const { return element == Type::Integer ? integers.size() : doubles.size(); }
+
+  Array make_generic() const {
+    Array array;
+    array.reserve(size());
+    if (element == Type::Integer) {
+      array.assign(integers.begin(), integers.end());
+    } else {
+      array.assign(doubles.begin(), doubles.end());
+    }
+    return array;
+  }
+
+  // built once on first const access, readers may race
+  const Array& get_generic() const {
+    Array* array = generic.load(std::memory_order_acquire);
+    if (array == nullptr) {
+      std::lock_guard<std::mutex> lock(mutex);
+      array = generic.load(std::memory_order_relaxed);
+      if (array == nullptr) {
+        array = new Array(make_generic());
+        generic.store(array, std::memory_order_release);
+      }
+    }
+    return *array;
+  }
+
+  // after modification of packed data
+  void reset_generic() { delete generic.exchange(nullptr); }
+
+  Type element;
+  std::vector<Integer> integers;
+  std::vector<Double> doubles;
+  mutable std::atomic<Array*> generic{nullptr};
+  mutable std::mutex mutex;
+};
+
+Json::Json() : m_type(Type::Nil) {
+  static_assert(sizeof(Json) <= 16);
+  m_value.integer = 0;
+}
+
+Json::Json(Json&& other) noexcept
+    : m_value(other.m_value),
+      m_type(other.m_type),
+      m_packed(other.m_packed),
+      m_big(other.m_big),
+      m_exposed(other.m_exposed) {
+  other.m_type = Type::Nil;
+  other.m_packed = false;
+  other.m_big = false;
+  other.m_exposed = false;
+}
+
+Json::Json(const Json& other)
+    : m_value(other.m_value), m_type(other.m_type), m_packed(other.m_packed), m_big(other.m_big) {
+  switch (m_type) {
+    case Type::Array:
+      if (m_packed) {
+        m_value.packed = new PackedArray(std::as_const(*other.m_value.packed));
+      } else {
+        m_value.array = new Shared<Array>(other.m_value.array->value);
+      }
+      break;
+    case Type::Integer:
+      if (m_big) {
+        m_value.string = new Shared<String>(other.m_value.string->value);
+      }
+      break;
+    case Type::Object:
+      m_value.object = new Shared<Object>(other.m_value.object->value);
+      break;
+    case Type::String:
+      m_value.string = new Shared<String>(other.m_value.string->value);
+      break;
+    default:
+      break;
+  }
+}
+
+Json Json::share() const {
+  Value value = m_value;
+  if (Block* shared = block(); shared != nullptr && !m_exposed) {
+    shared->refs.fetch_add(1, std::memory_order_relaxed);
+  } else if (m_packed) {
+    value.packed = new PackedArray(std::as_const(*m_value.packed));
+  } else if (is_array()) {
+    // references into the block may still be used, it is copied and the children are shared
+    Array array;
+    array.reserve(m_value.array->value.size());
+    for (auto& x : m_value.array->value) {
+      array.push_back(x.share());
+    }
+    value.array = new Shared<Array>(std::move(array));
+  } else if (is_object()) {
+    const Object& source = m_value.object->value;
+    Object object(source.order());
+    object.reserve(source.size());
+    for (auto& x : source) {
+      object.append(x.first, x.second.share());
+    }
+    object.m_index = source.m_index;
+    value.object = new Shared<Object>(std::move(object));
+  } else if (shared != nullptr) {
+    value.string = new Shared<String>(m_value.string->value);
+  }
+  Json result;
+  result.m_value = value;
+  result.m_type = m_type;
+  result.m_packed = m_packed;
+  result.m_big = m_big;
+  return result;
+}
+
+Json::~Json() { destroy(); }
+
+Json::Block* Json::block() const {
+  switch (m_type) {
+    case Type::Array:
+      return m_packed ? static_cast<Block*>(m_value.packed) : m_value.array;
+    case Type::Integer:
+      return m_big ? m_value.string : nullptr;
+    case Type::Object:
+      return m_value.object;
+    case Type::String:
+      return m_value.string;
+    default:
+      return nullptr;
+  }
+}
+
+namespace {
+
+// true if the caller held the last reference
+template <class T>
+bool release(T* block) {
+  return block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1;
+}
+
+template <class T>
+void make_unique(T*& block) {
+  if (block->refs.load(std::memory_order_acquire) != 1) {
+    const T& source = *block;
+    T* copy = new T(source);
+    if (release(block)) {
+      delete block;
+    }
+    block = copy;
+  }
+}
+}
+
+void Json::TextCache::release_all(TextCache* cache) {
+  // parts are released by this loop, not recursively by destructors
+  std::vector<TextCache*> pending{cache};
+  while (!pending.empty()) {
+    cache = pending.back();
+    pending.pop_back();
+    if (release(cache)) {
+      for (auto& part : cache->parts) {
+        pending.push_back(part.cache);
+      }
+      delete cache;
+    }
+  }
+}
+
+void Json::Block::reset_text() {
+  if (TextCache* cache = text.exchange(nullptr, std::memory_order_acquire)) {
+    TextCache::release_all(cache);
+  }
+}
+
+// Output of write_text(), a growing buffer with references to nested cached texts
+class Json::TextWriter : public Writer {
+ public:
+  TextWriter() = default;
+  ~TextWriter() override {
+    for (auto& part : parts) {
+      TextCache::release_all(part.cache);
+    }
+  }
+
+  size_t size() const { return m_buffer.empty() ? 0 : m_pos - &m_buffer[0]; }
+
+  // adds a reference to `cache` at the current position
+  void append_cache(TextCache* cache) {
+    cache->refs.fetch_add(1, std::memory_order_relaxed);
+    parts.push_back({size(), cache});
+  }
+
+  // moves text from `start` and parts from `first_part` to a new cache
+  TextCache* take(size_t start, size_t first_part) {
+    auto cache = new TextCache;
+    cache->text.assign(&m_buffer[0] + start, m_pos);
+    cache->size = cache->text.size();
+    for (size_t i = first_part; i < parts.size(); ++i) {
+      cache->parts.push_back({parts[i].offset - start, parts[i].cache});
+      cache->size += parts[i].cache->size;
+    }
+    parts.resize(first_part);
+    m_pos = &m_buffer[0] + start;
+    return cache;
+  }
+
+  std::vector<TextCache::Part> parts;
+
+ protected:
+  void overflow(size_t size) override {
+    size_t used = this->size();
+    m_buffer.resize(std::max({m_buffer.size() * 2, used + size, size_t(256)}));
+    m_pos = &m_buffer[0] + used;
+    m_end = &m_buffer[0] + m_buffer.size();
+  }
+
+ private:
+  std::string m_buffer;
+};
+
+void Json::destroy() {
+  Block* shared = block();
+  if (shared == nullptr || !release(shared)) {
+    return;
+  }
+  // Nested arrays and objects losing their last reference are collected here and freed by this
+  // loop instead of their parents' destructors, so freeing deep values does not recurse.
+  std::vector<Json> pending;
+  free_block(pending);
+  while (!pending.empty()) {
+    Json json = std::move(pending.back());
+    pending.pop_back();
+    json.free_block(pending);
+    json.m_type = Type::Nil;
+    json.m_packed = false;
+  }
+}
+
+void Json::free_block(std::vector<Json>& pending) {
+  auto take_unshared = [&pending](Json& child) {
+    if (((child.is_array() && !child.m_packed) || child.is_object()) &&
+        child.block()->refs.load(std::memory_order_acquire) == 1) {
+      pending.push_back(std::move(child));
+    }
+  };
+  switch (m_type) {
+    case Type::Array:
+      if (m_packed) {
+        delete m_value.packed;
+        break;
+      }
+      for (auto& x : m_value.array->value) {
+        take_unshared(x);
+      }
+      delete m_value.array;
+      break;
+    case Type::Object:
+      for (auto& x : m_value.object->value) {
+        take_unshared(x.second);
+      }
+      delete m_value.object;
+      break;
+    case Type::Integer:
+    case Type::String:
+      delete m_value.string;
+      break;
+    default:
+      break;
+  }
+}
+
+void Json::detach() {
+  switch (m_type) {
+    case Type::Array:
+      if (m_packed) {
+        make_unique(m_value.packed);
+        m_value.packed->reset_generic();
+      } else {
+        make_unique(m_value.array);
+      }
+      break;
+    case Type::Object:
+      make_unique(m_value.object);
+      break;
+    case Type::String:
+      make_unique(m_value.string);
+      break;
+    default:
+      return;
+  }
+  // the block may be modified now, also through the references returned to the caller
+  m_exposed = true;
+  block()->interned = 0;
+  block()->hash.store(0, std::memory_order_relaxed);
+  block()->reset_text();
+}
+
+uint32_t Json::interned() const {
+  Block* shared = block();
+  return shared != nullptr ? shared->interned : 0;
 }
-Json::Json() {
-  static_assert(sizeof(Variant) == sizeof(decltype(m_value)));
-  static_assert(alignof(Variant) == alignof(decltype(m_value)));
-  new (m_value.__data) Variant(Nil{});
+
+void Json::set_interned(uint32_t id) { block()->interned = id; }
+
+namespace {
+
+inline size_t hash_combine(size_t seed, size_t value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+template <class Number>
+size_t hash_bits(Number value) {
+  uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(value));
+  return std::hash<uint64_t>()(bits);
 }
 
-Json::Json(Json&& other) : Json{} {
-  new (m_value.__data) Variant(std::move(other.variant()));
+// doubles are compared by representation, 0.0 and -0.0 are kept apart
+template <class Number>
+bool same_bits(const std::vector<Number>& a, const std::vector<Number>& b) {
+  // data() of an empty vector may be null, which memcmp does not accept
+  return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(Number)) == 0);
+}
 }
 
-Json::Json(const Json& other) : Json{} {
-  new (m_value.__data) Variant(other.variant());
+size_t Json::shallow_hash() const {
+  // children are identified by block address, scalars by value
+  auto node_hash = [](const Json& json) {
+    if (Block* shared = json.block()) {
+      return std::hash<const void*>()(shared);
+    }
+    switch (json.m_type) {
+      case Type::Boolean:
+        return hash_bits(json.m_value.boolean);
+      case Type::Integer:
+        return hash_bits(json.m_value.integer);
+      case Type::Double:
+        return hash_bits(json.m_value.number);
+      default:
+        return size_t(0);
+    }
+  };
+  size_t seed = size_t(m_type) + (m_packed ? 16 : 0);
+  if (m_packed) {
+    for (auto x : m_value.packed->integers) {
+      seed = hash_combine(seed, hash_bits(x));
+    }
+    for (auto x : m_value.packed->doubles) {
+      seed = hash_combine(seed, hash_bits(x));
+    }
+  } else if (is_array()) {
+    for (auto& x : m_value.array->value) {
+      seed = hash_combine(seed, node_hash(x));
+    }
+  } else if (is_object()) {
+    for (auto& x : m_value.object->value) {
+      seed = hash_combine(seed, std::hash<std::string>()(x.first));
+      seed = hash_combine(seed, node_hash(x.second));
+    }
+  } else if (is_string() || m_big) {
+    seed = hash_combine(seed, std::hash<std::string>()(m_value.string->value));
+  } else {
+    seed = hash_combine(seed, node_hash(*this));
+  }
+  return seed;
+}
+
+bool Json::same_node(const Json& other) const {
+  if (m_type != other.m_type || m_packed != other.m_packed || m_big != other.m_big) {
+    return false;
+  }
+  if (m_big) {
+    return block() == other.block();
+  }
+  switch (m_type) {
+    case Type::Boolean:
+      return m_value.boolean == other.m_value.boolean;
+    case Type::Integer:
+      if (m_big || other.m_big) {
+        return m_big && other.m_big && m_value.string->value == other.m_value.string->value;
+      }
+      return m_value.integer == other.m_value.integer;
+    case Type::Nil:
+      return true;
+    case Type::Double:
+      return std::memcmp(&m_value.number, &other.m_value.number, sizeof(Double)) == 0;
+    default:
+      return block() == other.block();
+  }
+}
+
+namespace {
+
+// splitmix64 finalizer
+inline uint64_t mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+inline uint64_t combine(uint64_t seed, uint64_t value) { return mix(seed ^ (value + 0x9e3779b97f4a7c15ull)); }
+
+// salts follow the type order
+inline uint64_t hash_of(Json::Boolean value) { return combine(1, value); }
+inline uint64_t hash_of(Json::Integer value) { return combine(2, value); }
+inline uint64_t hash_of(Json::Double value) {
+  // 0.0 == -0.0
+  if (value == 0) {
+    value = 0;
+  }
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return combine(5, bits);
+}
+inline uint64_t hash_of(std::string_view value) { return combine(6, std::hash<std::string_view>()(value)); }
+
+template <class Number>
+uint64_t hash_of(const std::vector<Number>& numbers) {
+  uint64_t seed = 0;
+  for (auto x : numbers) {
+    seed = combine(seed, hash_of(x));
+  }
+  return seed;
+}
+}
+
+uint64_t Json::hash() const {
+  Block* shared = block();
+  if (shared != nullptr) {
+    uint64_t cached = shared->hash.load(std::memory_order_relaxed);
+    if (cached != 0) {
+      return cached;
+    }
+  }
+  uint64_t result = 0;
+  switch (m_type) {
+    case Type::Array:
+      if (auto integers = packed_integers()) {
+        result = hash_of(*integers);
+      } else if (auto doubles = packed_doubles()) {
+        result = hash_of(*doubles);
+      } else {
+        for (auto& x : m_value.array->value) {
+          result = combine(result, x.hash());
+        }
+      }
+      break;
+    case Type::Boolean:
+      return hash_of(m_value.boolean);
+    case Type::Integer:
+      return m_big ? combine(2, std::hash<std::string>()(m_value.string->value)) : hash_of(m_value.integer);
+    case Type::Nil:
+      return 3;
+    case Type::Object: {
+      // independent of key order, which does not affect equality
+      uint64_t sum = 0;
+      for (auto& x : m_value.object->value) {
+        sum += combine(hash_of(x.first), x.second.hash());
+      }
+      result = combine(4, sum);
+      break;
+    }
+    case Type::Double:
+      return hash_of(m_value.number);
+    case Type::String:
+      result = hash_of(m_value.string->value);
+      break;
+  }
+  if (result == 0) {
+    result = 1;
+  }
+  // an exposed block may still be changed through references, without resetting the cache
+  if (!m_exposed) {
+    shared->hash.store(result, std::memory_order_relaxed);
+  }
+  return result;
+}
+
+bool Json::shallow_equal(const Json& other) const {
+  if (m_type != other.m_type || m_packed != other.m_packed || m_big != other.m_big) {
+    return false;
+  }
+  if (m_big) {
+    return m_value.string->value == other.m_value.string->value;
+  }
+  if (m_packed) {
+    auto& a = *m_value.packed;
+    auto& b = *other.m_value.packed;
+    return a.element == b.element && same_bits(a.integers, b.integers) && same_bits(a.doubles, b.doubles);
+  }
+  switch (m_type) {
+    case Type::Array: {
+      auto& a = m_value.array->value;
+      auto& b = other.m_value.array->value;
+      return a.size() == b.size() &&
+             std::equal(a.begin(), a.end(), b.begin(), [](auto& x, auto& y) { return x.same_node(y); });
+    }
+    case Type::Object: {
+      auto& a = m_value.object->value;
+      auto& b = other.m_value.object->value;
+      return a.order() == b.order() && a.size() == b.size() &&
+             std::equal(a.begin(), a.end(), b.begin(),
+                        [](auto& x, auto& y) { return x.first == y.first && x.second.same_node(y.second); });
+    }
+    case Type::String:
+      return m_value.string->value == other.m_value.string->value;
+    default:
+      return same_node(other);
+  }
 }
 
-Json::~Json() { reinterpret_cast<Variant*>(m_value.__data)->~Variant(); }
+void Json::unpack() {
+  PackedArray* packed = m_value.packed;
+  Shared<Array>* array;
+  if (packed->refs.load(std::memory_order_acquire) == 1) {
+    Array* generic = packed->generic.exchange(nullptr);
+    array = generic != nullptr ? new Shared<Array>(std::move(*generic)) : new Shared<Array>(packed->make_generic());
+    delete generic;
+    delete packed;
+  } else {
+    array = new Shared<Array>(packed->get_generic());
+    if (release(packed)) {
+      delete packed;
+    }
+  }
+  m_value.array = array;
+  m_packed = false;
+}
 
-bool Json::is_array() const { return variant().index() == 0; }
+bool Json::is_array() const { return m_type == Type::Array; }
 
-bool Json::is_bool() const { return variant().index() == 1; }
+bool Json::is_bool() const { return m_type == Type::Boolean; }
 
-bool Json::is_integer() const { return variant().index() == 2; }
+bool Json::is_integer() const { return m_type == Type::Integer; }
 
-bool Json::is_null() const { return variant().index() == 3; }
+bool Json::is_null() const { return m_type == Type::Nil; }
 
-bool Json::is_object() const { return variant().index() == 4; }
+bool Json::is_object() const { return m_type == Type::Object; }
 
-bool Json::is_double() const { return variant().index() == 5; }
+bool Json::is_double() const { return m_type == Type::Double; }
 
 bool Json::is_number() const { return is_double() || is_integer(); }
 
-bool Json::is_string() const { return variant().index() == 6; }
+bool Json::is_string() const { return m_type == Type::String; }
 
 Json::Boolean Json::get_bool() const {
   if (!is_bool()) {
     throw JsonGetException("not a bool");
   }
-  return get<Boolean>(variant());
+  return m_value.boolean;
 }
 
 Json::Boolean& Json::get_bool() {
   if (!is_bool()) {
     throw JsonGetException("not a bool");
   }
-  return get<Boolean>(variant());
+  return m_value.boolean;
 }
 
 Json::Integer Json::get_integer() const {
   if (!is_integer()) {
     throw JsonGetException("not an integer");
   }
-  return get<Integer>(variant());
+  if (m_big) {
+    throw JsonGetException("integer " + m_value.string->value + " is out of range");
+  }
+  return m_value.integer;
 }
 
 Json::Integer& Json::get_integer() {
   if (!is_integer()) {
     throw JsonGetException("not an integer");
   }
-  return get<Integer>(variant());
+  if (m_big) {
+    throw JsonGetException("integer " + m_value.string->value + " is out of range");
+  }
+  return m_value.integer;
 }
 
+const Json::String* Json::big_integer() const { return m_big ? &m_value.string->value : nullptr; }
+
 const Json::Object& Json::get_object() const {
   if (!is_object()) {
     throw JsonGetException("not an object");
   }
-  return get<Object>(variant());
+  return m_value.object->value;
 }
 
 Json::Object& Json::get_object() {
   if (!is_object()) {
     throw JsonGetException("not an object");
   }
-  return get<Object>(variant());
+  detach();
+  return m_value.object->value;
 }
 
 Json::Double Json::get_double() const {
   if (!is_double()) {
     throw JsonGetException("not a double");
   }
-  return get<Double>(variant());
+  return m_value.number;
 }
 
 Json::Double& Json::get_double() {
   if (!is_double()) {
     throw JsonGetException("not a double");
   }
-  return get<Double>(variant());
+  return m_value.number;
 }
 
 Json::Double Json::get_number() const {
+  if (m_big) return std::strtod(m_value.string->value.c_str(), nullptr);
   if (is_integer()) return get_integer();
   if (!is_double()) {
     throw JsonGetException("not a number");
   }
-  return get<Double>(variant());
+  return m_value.number;
 }
 
 const Json::String& Json::get_string() const {
   if (!is_string()) {
     throw JsonGetException("not a string");
   }
-  return get<String>(variant());
+  return m_value.string->value;
 }
 
 Json::String& Json::get_string() {
   if (!is_string()) {
     throw JsonGetException("not a string");
   }
-  return get<String>(variant());
+  detach();
+  return m_value.string->value;
 }
 
 const Json::Array& Json::get_array() const {
   if (!is_array()) {
     throw JsonGetException("not an array");
   }
-  return get<Array>(variant());
+  if (m_packed) {
+    return m_value.packed->get_generic();
+  }
+  return m_value.array->value;
 }
 
 Json::Array& Json::get_array() {
   if (!is_array()) {
     throw JsonGetException("not an array");
   }
-  return get<Array>(variant());
+  if (m_packed) {
+    unpack();
+  }
+  detach();
+  return m_value.array->value;
+}
+
+const std::vector<Json::Integer>* Json::packed_integers() const {
+  return m_packed && m_value.packed->element == Type::Integer ? &m_value.packed->integers : nullptr;
+}
+
+const std::vector<Json::Double>* Json::packed_doubles() const {
+  return m_packed && m_value.packed->element == Type::Double ? &m_value.packed->doubles : nullptr;
 }
 
 const Json& Json::operator()(const std::string& name) const {
@@ -218,6 +1176,8 @@ Json& Json::operator[](size_t index) {
 size_t Json::size() const {
   if (is_object()) {
     return get_object().size();
+  } else if (m_packed) {
+    return m_value.packed->size();
   } else if (is_array()) {
     return get_array().size();
   } else {
@@ -233,20 +1193,36 @@ Json::Array::const_iterator Json::end() const { return get_array().end(); }
 
 std::vector<Json>::iterator Json::end() { return get_array().end(); }
 
-const Json::Variant& Json::variant() const { return *reinterpret_cast<const Variant*>(m_value.__data); }
-Json::Variant& Json::variant() { return *reinterpret_cast<Variant*>(m_value.__data); }
-
-void Json::readArray(std::istream& in) {
+void Json::readArray(std::istream& in, const ParseOptions& options) {
   char c;
   Json::Array value;
+  // numbers are collected here while all elements have the same type
+  std::unique_ptr<PackedArray> packed;
 
   read_non_space_or_throw(in,c);
 
   if (c != ']') {
+    Json element;
     for (; in.good();) {
       in.unget();
-      value.resize(value.size() + 1);
-      in >> value.back();
+      element.read(in, options);
+      if (value.empty() && packed == nullptr && options.pack_numeric_arrays && element.is_number() &&
+          !element.m_big) {
+        packed = std::make_unique<PackedArray>(element.m_type);
+      }
+      if (packed != nullptr && element.m_type == packed->element && !element.m_big) {
+        if (element.m_type == Type::Integer) {
+          packed->integers.push_back(element.m_value.integer);
+        } else {
+          packed->doubles.push_back(element.m_value.number);
+        }
+      } else {
+        if (packed != nullptr) {
+          value = packed->make_generic();
+          packed.reset();
+        }
+        value.push_back(std::move(element));
+      }
       read_non_space_or_throw(in,c);
 
       if (c == ']') {
@@ -257,7 +1233,14 @@ void Json::readArray(std::istream& in) {
     }
   }
 
-  variant() = std::move(value);
+  if (packed != nullptr) {
+    destroy();
+    m_value.packed = packed.release();
+    m_type = Type::Array;
+    m_packed = true;
+  } else {
+    *this = std::move(value);
+  }
 }
 
 void Json::readTrue(std::istream& in) {
@@ -267,7 +1250,7 @@ void Json::readTrue(std::istream& in) {
     throw JSONParseException("bad `true` keyword");
   }
 
-  variant() = true;
+  *this = true;
 }
 
 void Json::readFalse(std::istream& in) {
@@ -277,7 +1260,7 @@ void Json::readFalse(std::istream& in) {
     throw JSONParseException("bad `false` keyword");
   }
 
-  variant() = false;
+  *this = false;
 }
 
 void Json::readNumber(std::istream& in, char c) {
@@ -333,18 +1316,30 @@ void Json::readNumber(std::istream& in, char c) {
     } while (i >= '0' && i <= '9');
   }
 
+  const char* first = text.data();
+  const char* last = text.data() + text.size();
   if (exps || dots > 0) {
     double value;
-    std::istringstream(text) >> value;
-    variant() = value;
+    if (std::from_chars(first, last, value).ec != std::errc()) {
+      // out of range, strtod gives infinity or zero
+      value = std::strtod(text.c_str(), nullptr);
+    }
+    *this = value;
   } else {
     if (text.size() > 1 && ((text[0] == '0') || (text[0] == '-' && text[1] == '0'))) {
       throw JSONParseException("invalid number");
     }
 
     int64_t value;
-    std::istringstream(text) >> value;
-    variant() = value;
+    if (std::from_chars(first, last, value).ec == std::errc()) {
+      *this = value;
+    } else {
+      destroy();
+      m_value.string = new Shared<String>(std::move(text));
+      m_type = Type::Integer;
+      m_packed = false;
+      m_big = true;
+    }
   }
 }
 
@@ -355,12 +1350,12 @@ void Json::readNull(std::istream& in) {
     throw JSONParseException("bad `null` keyword");
   }
 
-  variant() = Nil{};
+  *this = Nil{};
 }
 
-void Json::readObject(std::istream& in) {
+void Json::readObject(std::istream& in, const ParseOptions& options) {
   char c;
-  Json::Object value;
+  Json::Object value(options.preserve_key_order ? Object::Order::Insertion : Object::Order::Sorted);
   read_non_space_or_throw(in,c);
 
   if (c != '}') {
@@ -368,24 +1363,18 @@ void Json::readObject(std::istream& in) {
     for (; in.good();) {
       expect_char('"',c);
       name.clear();
-      for (; in.good();) {
-        in.read(&c, 1);
-        if (c == '"') {
-          break;
-        }
-
-        if (c == '\\') {
-          name += c;
-          in.read(&c, 1);
-        }
-
-        name += c;
-      }
+      read_string(in, name);
 
       read_non_space_or_throw(in,c);
       expect_char(':',c);
 
-      in >> value[name];
+      if (options.preserve_key_order) {
+        // first position, last value
+        auto it = value.emplace(std::move(name), Json()).first;
+        it->second.read(in, options);
+      } else {
+        value.append(std::move(name), Json()).second.read(in, options);
+      }
       read_non_space_or_throw(in,c);
       if (c == '}') {
         break;
@@ -395,36 +1384,20 @@ void Json::readObject(std::istream& in) {
       read_non_space_or_throw(in,c);
     }
   }
+  if (!options.preserve_key_order) {
+    value.sort_unique();
+  }
 
-  variant() = std::move(value);
+  *this = std::move(value);
 }
 
 void Json::readString(std::istream& in) {
-  char c;
   std::string value;
-
-  for (; in.good();) {
-    in.read(&c, 1);
-    if (c == '"') {
-      break;
-    }
-
-    if (c == '\\') {
-      value += c;
-      in.read(&c, 1);
-    }
-
-    value += c;
-  }
-
-  if (!in.good()) {
-    throw JSONParseException("unexpected EOF");
-  }
-
-  variant() = std::move(value);
+  read_string(in, value);
+  *this = std::move(value);
 }
 
-std::istream& JSON::operator>>(std::istream& in, Json& JSONValue) {
+void Json::read(std::istream& in, const ParseOptions& options) {
   char c;
   read_non_space_or_throw(in,c);
   while (c== '/'){
@@ -432,183 +1405,149 @@ std::istream& JSON::operator>>(std::istream& in, Json& JSONValue) {
     read_non_space_or_throw(in,c);
   }
   if (c == '[') {
-    JSONValue.readArray(in);
+    readArray(in, options);
   } else if (c == 't') {
-    JSONValue.readTrue(in);
+    readTrue(in);
   } else if (c == 'f') {
-    JSONValue.readFalse(in);
+    readFalse(in);
   } else if ((c == '-') || (c >= '0' && c <= '9') || ((c == '.'))) {
-    JSONValue.readNumber(in, c);
+    readNumber(in, c);
   } else if (c == 'n') {
-    JSONValue.readNull(in);
+    readNull(in);
   } else if (c == '{') {
-    JSONValue.readObject(in);
+    readObject(in, options);
   } else if (c == '"') {
-    JSONValue.readString(in);
+    readString(in);
   } else {
     throw JSONParseException("unexpected char `" + std::string(1, c) + "`");
   }
+  if (options.interner != nullptr) {
+    options.interner->intern_node(*this);
+  }
+}
+
+std::istream& JSON::operator>>(std::istream& in, Json& JSONValue) {
+  try {
+    JSONValue.read(in, ParseOptions{});
+  } catch (JSONParseException& e) {
+    throw locate(in, e);
+  }
   return in;
 }
 
+Json JSON::parse(std::istream& in, const ParseOptions& options) {
+  Json json;
+  try {
+    json.read(in, options);
+  } catch (JSONParseException& e) {
+    throw locate(in, e);
+  }
+  return json;
+}
+
+Json JSON::parse(std::string_view text, const ParseOptions& options) {
+  std::istringstream in{std::string(text)};
+  return parse(in, options);
+}
+
 std::ostream& JSON::operator<<(std::ostream& out, const Json& json) {
-  using std::isnan;
-
-  if (json.is_array()) {
-    const Json::Array& array = json.get_array();
-    out << '[';
-    if (array.size() > 0) {
-      out << array[0];
-      for (size_t i = 1; i < array.size(); ++i) {
-        out << ',' << array[i];
-      }
-    }
-    out << ']';
-  } else if (json.is_bool()) {
-    out << (json.get_bool() ? "true" : "false");
-  } else if (json.is_integer()) {
-    out << json.get_integer();
-  } else if (json.is_null()) {
-    out << "null";
-  } else if (json.is_object()) {
-    const Json::Object& object = json.get_object();
-    out << '{';
-    auto iter = object.begin();
-    if (iter != object.end()) {
-      out << "\"" << iter->first << "\":" << iter->second;
-      ++iter;
-      for (; iter != object.end(); ++iter) {
-        out << ","
-            << "\"" << iter->first << "\":" << iter->second;
-      }
+  StreamWriter writer(out);
+  writer.write_json(json);
+  return out;
+}
+
+void Json::pretty_print(std::ostream& out, int tab_size, int offset, bool first_line_offset) const {
+  ConsolePrettyPrinter(out, tab_size).print(*this, offset, first_line_offset);
+}
+
+void Json::pretty_print(Writer& out, int tab_size, int offset, bool first_line_offset) const {
+  PrettyPrinter(out, tab_size).print(*this, offset, first_line_offset);
+}
+
+void Json::write_cached(Writer& out, size_t min_size) const {
+  if (!is_array() && !is_object()) {
+    out.write_json(*this);
+    return;
+  }
+  if (TextCache* cache = block()->text.load(std::memory_order_acquire)) {
+    cache->write(out);
+    return;
+  }
+  TextWriter text;
+  write_text(text, min_size);
+  if (text.size() != 0) {
+    TextCache* cache = text.take(0, 0);
+    if (m_exposed) {
+      // not kept, as a change through a reference would not drop it, like for hash(). write()
+      // goes through Writer::append(), which copies, so the text may be released before flush()
+      cache->write(out);
+      TextCache::release_all(cache);
+      return;
     }
-    out << '}';
-  } else if (json.is_double()) {
-    const double upper_fixed = 1e5;
-    const double lower_fixed = 1.0 / upper_fixed;
-    double d = json.get_double();
-    if (std::isnan(d) || std::isinf(d)) {
-      throw std::runtime_error("NaN or Inf is not representative in Json format");
-    }
-    if (d > upper_fixed || d < -upper_fixed || (d < lower_fixed && d > -lower_fixed)) {
-      std::ostringstream stream;
-      stream << std::scientific << std::setprecision(17) << json.get_double();
-      std::string value = stream.str();
-      auto epos = value.rfind('e');
-      auto pos = epos - 1;
-      while (pos > 0 && value[pos - 1] == '0') {
-        pos--;
-      }
-      if (value[pos - 1] == '.') {
-        pos--;
-      }
-      out << value.substr(0, pos);
-      out << value.substr(epos);
+    // the whole value is cached even if it is short
+    TextCache* expected = nullptr;
+    if (block()->text.compare_exchange_strong(expected, cache, std::memory_order_acq_rel)) {
+      text.append_cache(cache);
     } else {
-      std::ostringstream stream;
-      stream << std::fixed << std::setprecision(17) << json.get_double();
-      std::string value = stream.str();
-      while (value.size() > 1 && value[value.size() - 2] != '.' && value[value.size() - 1] == '0') {
-        value.resize(value.size() - 1);
-      }
-      out << value;
+      TextCache::release_all(cache);
+      text.append_cache(expected);
     }
-  } else if (json.is_string()) {
-    out << '"' << json.get_string() << '"';
-  } else {
-    assert(false);
   }
-
-  return out;
+  text.parts[0].cache->write(out);
 }
 
-void Json::pretty_print(std::ostream& out, int tab_size, int offset, bool first_line_offset) const {
-  namespace cs = ConsoleStyle;
-  if (first_line_offset) {
-    out << std::string(offset, ' ');
-  }
-  if (is_array()) {
-    const Json::Array& array = get_array();
-    out << "[";
-    if (array.size() > 0) {
-      out << "\n";
-      array[0].pretty_print(out, tab_size, offset + tab_size);
-      for (size_t i = 1; i < array.size(); ++i) {
-        out << ",\n";
-        array[i].pretty_print(out, tab_size, offset + tab_size);
-      }
-      out << "\n";
-      out << std::string(offset, ' ');
-    }
-    out << ']';
-  } else if (is_bool()) {
-    out << cs::bright() << (get_bool() ? "true" : "false");
-  } else if (is_integer()) {
-    out << cs::white() << get_integer();
-  } else if (is_null()) {
-    out << cs::bright() << "null";
-  } else if (is_object()) {
-    const Json::Object& object = get_object();
-    out << "{";
-    auto iter = object.begin();
-    if (iter != object.end()) {
-      out << "\n";
-      int maxKeyLength = object.empty() ? 0ul : std::max_element(object.begin(), object.end(), [](auto& a, auto& b) {
-                                                  return a.first.size() < b.first.size();
-                                                })->first.size();
-      out << std::string(offset + tab_size, ' ');
-      out << cs::bright() << cs::magenta() << "\"" << iter->first << "\""
-          << std::string(maxKeyLength - iter->first.size(), ' ');
-      out << ": ";
-      iter->second.pretty_print(out, tab_size, offset + tab_size + maxKeyLength + 4, false);
-      ++iter;
-      for (; iter != object.end(); ++iter) {
-        out << ",\n";
-        out << std::string(offset + tab_size, ' ');
-        out << cs::bright() << cs::magenta() << "\"" << iter->first << "\""
-            << std::string(maxKeyLength - iter->first.size(), ' ');
-        out << ": ";
-        iter->second.pretty_print(out, tab_size, offset + tab_size + maxKeyLength + 4, false);
-      }
-      out << "\n";
-      out << std::string(offset, ' ');
-    }
-    out << '}';
-  } else if (is_double()) {
-    SET_SCOPED_CONSOLE_STYLE(out, cs::white());
-    const double upper_fixed = 1e5;
-    const double lower_fixed = 1.0 / upper_fixed;
-    double d = get_double();
-    if (std::isnan(d) || std::isinf(d)) {
-      throw std::runtime_error("NaN or Inf is not representative in Json format");
-    }
-    if (d > upper_fixed || d < -upper_fixed || (d < lower_fixed && d > -lower_fixed)) {
-      std::ostringstream stream;
-      stream << std::scientific << std::setprecision(14) << get_double();
-      std::string value = stream.str();
-      auto epos = value.rfind('e');
-      auto pos = epos - 1;
-      while (pos > 0 && value[pos - 1] == '0') {
-        pos--;
-      }
-      if (value[pos - 1] == '.') {
-        pos--;
-      }
-      out << value.substr(0, pos);
-      out << value.substr(epos);
+void Json::write_text(TextWriter& out, size_t min_size) const {
+  size_t start = out.size();
+  size_t first_part = out.parts.size();
+  auto write_nested = [&out, min_size](const Json& json) {
+    if (!json.is_array() && !json.is_object()) {
+      out.write_json(json);
+    } else if (TextCache* cache = json.block()->text.load(std::memory_order_acquire)) {
+      out.append_cache(cache);
     } else {
-      std::ostringstream stream;
-      stream << std::fixed << std::setprecision(14) << get_double();
-      std::string value = stream.str();
-      while (value.size() > 1 && value[value.size() - 2] != '.' && value[value.size() - 1] == '0') {
-        value.resize(value.size() - 1);
+      json.write_text(out, min_size);
+    }
+  };
+  if (m_packed) {
+    out.write_json(*this);
+  } else if (is_array()) {
+    out.put('[');
+    for (auto& x : m_value.array->value) {
+      if (&x != &m_value.array->value.front()) {
+        out.put(',');
       }
-      out << value;
+      write_nested(x);
     }
-  } else if (is_string()) {
-    out << cs::bright() << cs::green() << '"' << get_string() << '"';
+    out.put(']');
   } else {
-    assert(false);
+    out.put('{');
+    for (auto& x : m_value.object->value) {
+      if (&x != &*m_value.object->value.begin()) {
+        out.put(',');
+      }
+      out.write_string(x.first);
+      out.put(':');
+      write_nested(x.second);
+    }
+    out.put('}');
+  }
+
+  size_t size = out.size() - start;
+  for (size_t i = first_part; i < out.parts.size(); ++i) {
+    size += out.parts[i].cache->size;
+  }
+  // exposed values keep their text in the output only, their children may still be cached
+  if (size < min_size || m_exposed) {
+    return;
+  }
+  TextCache* cache = out.take(start, first_part);
+  TextCache* expected = nullptr;
+  if (block()->text.compare_exchange_strong(expected, cache, std::memory_order_acq_rel)) {
+    out.append_cache(cache);
+  } else {
+    // cached by another thread meanwhile
+    TextCache::release_all(cache);
+    out.append_cache(expected);
   }
 }
 
@@ -625,9 +1564,9 @@ Json& Json::push_back(Json&& val) {
 }
 
 Json& Json::insert(const std::string key, const Json& value) {
-  auto& obj = get_object();
-  auto& res = obj[key] = value;
-  return res;
+  // value may be a part of this
+  Json copy(value);
+  return get_object()[key] = std::move(copy);
 }
 
 Json& Json::insert(const std::string key, Json&& value) {
@@ -637,125 +1576,197 @@ Json& Json::insert(const std::string key, Json&& value) {
 }
 
 Json& Json::operator=(const Json& value) {
-  variant() = value.variant();
+  // value may be a part of this
+  return *this = Json(value);
+}
+
+Json& Json::operator=(Json&& value) noexcept {
+  if (this != &value) {
+    Value taken = value.m_value;
+    Type type = value.m_type;
+    bool packed = value.m_packed;
+    bool big = value.m_big;
+    bool exposed = value.m_exposed;
+    value.m_type = Type::Nil;
+    value.m_packed = false;
+    value.m_big = false;
+    value.m_exposed = false;
+    destroy();
+    m_value = taken;
+    m_type = type;
+    m_packed = packed;
+    m_big = big;
+    m_exposed = exposed;
+  }
   return *this;
 }
 
-Json& Json::operator=(Json&& value) {
-  variant() = std::move(value.variant());
-  return *this;
-}
+Json& Json::operator=(const Json::Array& value) { return *this = Json(value); }
 
-Json& Json::operator=(const Json::Array& value) {
-  variant() = value;
-  return *this;
-}
+Json& Json::operator=(Json::Array&& value) { return *this = Json(std::move(value)); }
 
-Json& Json::operator=(Json::Array&& value) {
-  variant() = std::move(value);
-  return *this;
-}
+Json& Json::operator=(Json::Boolean value) { return *this = Json(value); }
 
-Json& Json::operator=(Json::Boolean value) {
-  variant() = value;
-  return *this;
-}
+Json& Json::operator=(Json::Integer value) { return *this = Json(value); }
 
-Json& Json::operator=(Json::Integer value) {
-  variant() = value;
-  return *this;
-}
+Json& Json::operator=(Json::Nil) { return *this = Json(); }
 
-Json& Json::operator=(Json::Nil) {
-  variant() = Nil{};
-  return *this;
-}
+Json& Json::operator=(const Object& value) { return *this = Json(value); }
 
-Json& Json::operator=(const Object& value) {
-  variant() = value;
-  return *this;
-}
+Json& Json::operator=(Object&& value) { return *this = Json(std::move(value)); }
 
-Json& Json::operator=(Object&& value) {
-  variant() = std::move(value);
-  return *this;
-}
+Json& Json::operator=(Json::Double value) { return *this = Json(value); }
 
-Json& Json::operator=(Json::Double value) {
-  variant() = value;
-  return *this;
-}
+Json& Json::operator=(const Json::String& value) { return *this = Json(value); }
 
-Json& Json::operator=(const Json::String& value) {
-  variant() = value;
-  return *this;
-}
+Json& Json::operator=(std::string&& value) { return *this = Json(std::move(value)); }
 
-Json& Json::operator=(std::string&& value) {
-  variant() = std::move(value);
-  return *this;
+Json& Json::operator=(const char* value) { return *this = Json(value); }
+
+Json::Json(const Json::Array& value) : m_type(Type::Array) { m_value.array = new Shared<Array>(value); }
+
+Json::Json(Json::Array&& value) : m_type(Type::Array) {
+  // references into moved elements stay valid
+  m_exposed = std::any_of(value.begin(), value.end(), [](const Json& x) { return x.m_exposed; });
+  m_value.array = new Shared<Array>(std::move(value));
 }
 
+Json::Json(bool value) : m_type(Type::Boolean) { m_value.boolean = value; }
 
-Json& Json::operator=(const char* value) { return operator=(Json::String(value)); }
+Json::Json(int64_t value) : m_type(Type::Integer) { m_value.integer = value; }
 
-Json::Json(const Json::Array& value) {
-  new (m_value.__data) Variant(std::move(value));
-}
+Json::Json(int value) : m_type(Type::Integer) { m_value.integer = value; }
 
-Json::Json(Json::Array&& value) {
-  new (m_value.__data) Variant(std::move(value));
+Json::Json(Json::Nil) : Json() {
 }
 
-Json::Json(bool value) {
-  new (m_value.__data) Variant(value);
-}
+Json::Json(const Json::Object& value) : m_type(Type::Object) { m_value.object = new Shared<Object>(value); }
 
-Json::Json(int64_t value) {
-  new (m_value.__data) Variant(value);
+Json::Json(Json::Object&& value) : m_type(Type::Object) {
+  // references into moved values stay valid
+  m_exposed = std::any_of(value.begin(), value.end(), [](const Object::value_type& x) { return x.second.m_exposed; });
+  m_value.object = new Shared<Object>(std::move(value));
 }
 
-Json::Json(int value) {
-  new (m_value.__data) Variant(Integer(value));
-}
+Json::Json(double value) : m_type(Type::Double) { m_value.number = value; }
 
-Json::Json(Json::Nil) : Json() {
-}
+Json::Json(const Json::String& value) : m_type(Type::String) { m_value.string = new Shared<String>(value); }
 
-Json::Json(const Json::Object& value) {
-  new (m_value.__data) Variant(value);
-}
+Json::Json(Json::String&& value) : m_type(Type::String) { m_value.string = new Shared<String>(std::move(value)); }
 
-Json::Json(Json::Object&& value) {
-  new (m_value.__data) Variant(std::move(value));
-}
+Json::Json(const char* value) : m_type(Type::String) { m_value.string = new Shared<String>(value); }
 
-Json::Json(double value) {
-  new (m_value.__data) Variant(value);
-}
+bool Json::operator!=(const Json& other) const { return !(*this == other); }
 
-Json::Json(const Json::String& value) {
-  new (m_value.__data) Variant(value);
+namespace {
+// integers without leading zeros are ordered by sign, number of digits and digits
+bool big_integer_less(const Json& a, const Json& b) {
+  auto negative = [](const Json& x) { return x.big_integer() ? (*x.big_integer())[0] == '-' : x.get_integer() < 0; };
+  if (negative(a) != negative(b)) {
+    return negative(a);
+  }
+  bool less;
+  if (a.big_integer() == nullptr || b.big_integer() == nullptr) {
+    // any big integer is further from zero
+    less = a.big_integer() == nullptr;
+  } else {
+    const std::string& x = *a.big_integer();
+    const std::string& y = *b.big_integer();
+    if (x == y) {
+      return false;
+    }
+    less = x.size() != y.size() ? x.size() < y.size() : x < y;
+  }
+  return negative(a) ? !less : less;
 }
-
-Json::Json(Json::String&& value) {
-  new (m_value.__data) Variant(std::move(value));
 }
 
-Json::Json(const char* value) {
-  new (m_value.__data) Variant(Json::String(value));
+bool Json::operator<(const Json& other) const {
+  if (m_type != other.m_type) {
+    return m_type < other.m_type;
+  }
+  switch (m_type) {
+    case Type::Array:
+      if (m_packed && other.m_packed && m_value.packed->element == other.m_value.packed->element) {
+        auto& a = *m_value.packed;
+        auto& b = *other.m_value.packed;
+        return a.element == Type::Integer ? a.integers < b.integers : a.doubles < b.doubles;
+      }
+      return get_array() < other.get_array();
+    case Type::Boolean:
+      return m_value.boolean < other.m_value.boolean;
+    case Type::Integer:
+      if (m_big || other.m_big) {
+        return big_integer_less(*this, other);
+      }
+      return m_value.integer < other.m_value.integer;
+    case Type::Nil:
+      return false;
+    case Type::Object:
+      return m_value.object->value < other.m_value.object->value;
+    case Type::Double:
+      return m_value.number < other.m_value.number;
+    case Type::String:
+      return m_value.string->value < other.m_value.string->value;
+  }
+  return false;
 }
 
-bool Json::operator!=(const Json& other) const { return variant() != other.variant(); }
-
-bool Json::operator<(const Json& other) const { return variant() < other.variant(); }
-
-bool Json::operator==(const Json& other) const { return variant() == other.variant(); }
+bool Json::operator==(const Json& other) const {
+  if (m_type != other.m_type) {
+    return false;
+  }
+  Block* a = block();
+  Block* b = other.block();
+  if (a != nullptr && a == b) {
+    return true;
+  }
+  if (a != nullptr && b != nullptr) {
+    // distinct blocks of one interner may still be equal: interning keeps apart 0.0 and -0.0,
+    // key orders and packed and generic arrays, which are equal here
+    uint64_t hash_a = a->hash.load(std::memory_order_relaxed);
+    uint64_t hash_b = b->hash.load(std::memory_order_relaxed);
+    if (hash_a != 0 && hash_b != 0 && hash_a != hash_b) {
+      return false;
+    }
+  }
+  switch (m_type) {
+    case Type::Array:
+      if (m_packed && other.m_packed && m_value.packed->element == other.m_value.packed->element) {
+        auto& a = *m_value.packed;
+        auto& b = *other.m_value.packed;
+        return a.element == Type::Integer ? a.integers == b.integers : a.doubles == b.doubles;
+      }
+      if ((m_packed && other.m_packed) || size() != other.size()) {
+        return false;
+      }
+      return get_array() == other.get_array();
+    case Type::Boolean:
+      return m_value.boolean == other.m_value.boolean;
+    case Type::Integer:
+      if (m_big || other.m_big) {
+        return m_big && other.m_big && m_value.string->value == other.m_value.string->value;
+      }
+      return m_value.integer == other.m_value.integer;
+    case Type::Nil:
+      return true;
+    case Type::Object:
+      return m_value.object->value == other.m_value.object->value;
+    case Type::Double:
+      return m_value.number == other.m_value.number;
+    case Type::String:
+      return m_value.string->value == other.m_value.string->value;
+  }
+  return false;
+}
 
 std::string JSON::to_string(const Json& json) {
-  std::ostringstream ostr;
-  ostr << json;
-  return ostr.str();
+  std::string result;
+  result.reserve(serialized_size(json));
+  StringWriter writer(result);
+  writer.write_json(json);
+  writer.flush();
+  return result;
 }
 
 bool JSON::operator==(const Json::Nil&, const Json::Nil&) { return true; };
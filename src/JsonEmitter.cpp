@@ -0,0 +1,127 @@
+#include "concise_json_schema/JsonEmitter.h"
+#include "concise_json_schema/JsonException.h"
+
+using namespace JSON;
+
+namespace {
+inline void check(bool condition, const char* what) {
+#ifndef NDEBUG
+  if (!condition) {
+    throw JsonException(std::string("Emitter: ") + what);
+  }
+#endif
+}
+}
+
+Emitter::Emitter(Writer& out) : m_out(out) {}
+
+void Emitter::before_value() {
+  if (m_stack.empty()) {
+    check(!m_need_comma, "only one value is allowed at top level");
+  } else if (m_stack.back() == '{') {
+    check(m_after_key, "object value without a key");
+  } else if (m_need_comma) {
+    m_out.put(',');
+  }
+  m_after_key = false;
+}
+
+void Emitter::before_close(char open) {
+  // checked in release builds too, popping an empty stack is undefined behavior
+  if (m_stack.empty() || m_stack.back() != open) {
+    throw JsonException("Emitter: unbalanced closing bracket");
+  }
+  check(!m_after_key, "object key without a value");
+  m_stack.pop_back();
+  m_need_comma = true;
+}
+
+Emitter& Emitter::begin_object() {
+  before_value();
+  m_out.put('{');
+  m_stack.push_back('{');
+  m_need_comma = false;
+  return *this;
+}
+
+Emitter& Emitter::end_object() {
+  before_close('{');
+  m_out.put('}');
+  return *this;
+}
+
+Emitter& Emitter::begin_array() {
+  before_value();
+  m_out.put('[');
+  m_stack.push_back('[');
+  m_need_comma = false;
+  return *this;
+}
+
+Emitter& Emitter::end_array() {
+  before_close('[');
+  m_out.put(']');
+  return *this;
+}
+
+Emitter& Emitter::key(std::string_view name) {
+  check(!m_stack.empty() && m_stack.back() == '{', "key outside of object");
+  check(!m_after_key, "two keys in a row");
+  if (m_need_comma) {
+    m_out.put(',');
+  }
+  m_out.write_string(name);
+  m_out.put(':');
+  m_after_key = true;
+  return *this;
+}
+
+Emitter& Emitter::value(Json::Nil) {
+  before_value();
+  m_out.append("null", 4);
+  m_need_comma = true;
+  return *this;
+}
+
+Emitter& Emitter::value(Json::Boolean value) {
+  before_value();
+  if (value) {
+    m_out.append("true", 4);
+  } else {
+    m_out.append("false", 5);
+  }
+  m_need_comma = true;
+  return *this;
+}
+
+Emitter& Emitter::value(int value) { return this->value(Json::Integer(value)); }
+
+Emitter& Emitter::value(Json::Integer value) {
+  before_value();
+  m_out.write_integer(value);
+  m_need_comma = true;
+  return *this;
+}
+
+Emitter& Emitter::value(Json::Double value) {
+  before_value();
+  m_out.write_double(value);
+  m_need_comma = true;
+  return *this;
+}
+
+Emitter& Emitter::value(std::string_view value) {
+  before_value();
+  m_out.write_string(value);
+  m_need_comma = true;
+  return *this;
+}
+
+Emitter& Emitter::value(const char* value) { return this->value(std::string_view(value)); }
+
+Emitter& Emitter::value(const Json& json) {
+  before_value();
+  m_out.write_json(json);
+  m_need_comma = true;
+  return *this;
+}
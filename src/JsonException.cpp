@@ -9,7 +9,17 @@ JSONRangeException::JSONRangeException(const Json& ref, size_t index)
     : JsonException("index " + std::to_string(index) + " is out of range of Json array [0, .. , " +
                     std::to_string(ref.size())) {}
 
+JsonPatchException::JsonPatchException(const std::string& what, size_t operation)
+    : JsonException("JSON patch operation " + std::to_string(operation) + ": " + what), m_operation(operation) {}
+
 JSONParseException::JSONParseException(const std::string& what)
     : JsonException(what) {}
 
 JSONParseException::JSONParseException(const char* what) : JsonException(what){}
+
+JSONParseException::JSONParseException(const JSONParseException& error, size_t offset, size_t line, size_t column)
+    : JsonException(std::string(error.what()) + " at line " + std::to_string(line) + ", column " +
+                    std::to_string(column) + " (offset " + std::to_string(offset) + ")"),
+      m_offset(offset),
+      m_line(line),
+      m_column(column) {}
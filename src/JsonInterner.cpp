@@ -0,0 +1,50 @@
+#include "concise_json_schema/JsonInterner.h"
+
+#include <atomic>
+
+using namespace JSON;
+
+namespace {
+std::atomic<uint32_t> next_interner_id{1};
+}
+
+Interner::Interner() : m_id(next_interner_id++) {}
+
+void Interner::clear() {
+  m_values.clear();
+  // blocks still marked with the old id may be equal to blocks interned after
+  m_id = next_interner_id++;
+}
+
+Json& Interner::intern(Json& json) {
+  if (json.interned() == m_id) {
+    return json;
+  }
+  if (json.is_object()) {
+    for (auto& x : json.get_object()) {
+      intern(x.second);
+    }
+  } else if (json.is_array() && json.packed_integers() == nullptr && json.packed_doubles() == nullptr) {
+    for (auto& x : json.get_array()) {
+      intern(x);
+    }
+  }
+  intern_node(json);
+  return json;
+}
+
+void Interner::intern_node(Json& json) {
+  if (json.block() == nullptr) {
+    return;
+  }
+  auto inserted = m_values.insert(json.share());
+  if (inserted.second) {
+    // the id is not a part of the hash or equality
+    const_cast<Json&>(*inserted.first).set_interned(m_id);
+  }
+  json = inserted.first->share();
+}
+
+size_t Interner::Hash::operator()(const Json& json) const { return json.shallow_hash(); }
+
+bool Interner::Equal::operator()(const Json& a, const Json& b) const { return a.shallow_equal(b); }
@@ -0,0 +1,404 @@
+#include "concise_json_schema/JsonPatch.h"
+#include "concise_json_schema/JsonException.h"
+#include "concise_json_schema/JsonPointer.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace JSON;
+
+namespace {
+
+// Applies operations and keeps the inverse of every change, so a failed patch can be undone
+// without copying the document up front.
+class Patcher {
+ public:
+  explicit Patcher(Json& json) : m_json(json) {}
+
+  void apply(const Json& operation);
+  // undoes changes of all applied operations in reverse order
+  void rollback();
+
+ private:
+  struct Undo {
+    enum class Kind { Insert, Erase, Assign };
+    Kind kind;
+    // with concrete array indices
+    JsonPointer path;
+    Json value{};
+    // Insert of the value held in m_carried instead of `value`, for undoing moves
+    bool carried = false;
+  };
+
+  [[noreturn]] void fail(const std::string& what) const { throw JsonPatchException(what, m_operation); }
+
+  const Json& member(const Json::Object& operation, std::string_view name) const;
+  JsonPointer pointer(const Json::Object& operation, std::string_view name) const;
+  Json& container(const JsonPointer& path);
+  const Json& existing(const JsonPointer& path) const;
+
+  // add semantics of RFC 6902, returns the inverse change. `value` is moved from only on success.
+  Undo insert(const JsonPointer& path, Json&& value);
+  // moves out the value at `path` and removes its key or element
+  Json erase(const JsonPointer& path);
+
+  Json& m_json;
+  std::vector<Undo> m_undo;
+  // value being moved, outside of the document between erase and insert
+  Json m_carried;
+  size_t m_operation = 0;
+};
+
+const Json& Patcher::member(const Json::Object& operation, std::string_view name) const {
+  auto it = operation.find(name);
+  if (it == operation.end()) {
+    fail("missing `" + std::string(name) + "`");
+  }
+  return it->second;
+}
+
+JsonPointer Patcher::pointer(const Json::Object& operation, std::string_view name) const {
+  const Json& text = member(operation, name);
+  if (!text.is_string()) {
+    fail("`" + std::string(name) + "` is not a string");
+  }
+  try {
+    return JsonPointer(text.get_string());
+  } catch (JSONParseException& e) {
+    fail(e.what());
+  }
+}
+
+Json& Patcher::container(const JsonPointer& path) {
+  Json* parent = path.parent().find(m_json);
+  if (parent == nullptr) {
+    fail("path `" + to_string(path.parent()) + "` does not exist");
+  }
+  if (!parent->is_object() && !parent->is_array()) {
+    fail("`" + to_string(path.parent()) + "` is neither an object nor an array");
+  }
+  return *parent;
+}
+
+const Json& Patcher::existing(const JsonPointer& path) const {
+  const Json* value = path.find(std::as_const(m_json));
+  if (value == nullptr) {
+    fail("path `" + to_string(path) + "` does not exist");
+  }
+  return *value;
+}
+
+Patcher::Undo Patcher::insert(const JsonPointer& path, Json&& value) {
+  if (path.empty()) {
+    Undo undo{Undo::Kind::Assign, path, std::move(m_json)};
+    m_json = std::move(value);
+    return undo;
+  }
+  Json& parent = container(path);
+  if (parent.is_object()) {
+    auto& object = parent.get_object();
+    auto it = object.find(path.back().key);
+    if (it != object.end()) {
+      Undo undo{Undo::Kind::Assign, path, std::move(it->second)};
+      it->second = std::move(value);
+      return undo;
+    }
+    object.emplace(path.back().key, std::move(value));
+    return {Undo::Kind::Erase, path};
+  }
+  size_t index = path.back().key == "-" ? parent.size() : path.back().index;
+  if (index > parent.size()) {
+    fail("index `" + path.back().key + "` is out of range of `" + to_string(path.parent()) + "`");
+  }
+  auto& array = parent.get_array();
+  array.insert(array.begin() + index, std::move(value));
+  return {Undo::Kind::Erase, path.parent().push_back(index)};
+}
+
+Json Patcher::erase(const JsonPointer& path) {
+  if (path.empty()) {
+    fail("the whole document can't be removed");
+  }
+  Json& parent = container(path);
+  Json value;
+  if (parent.is_object()) {
+    auto& object = parent.get_object();
+    auto it = object.find(path.back().key);
+    if (it == object.end()) {
+      fail("path `" + to_string(path) + "` does not exist");
+    }
+    value = std::move(it->second);
+    object.erase(it);
+  } else {
+    if (path.back().index >= parent.size()) {
+      fail("index `" + path.back().key + "` is out of range of `" + to_string(path.parent()) + "`");
+    }
+    auto& array = parent.get_array();
+    value = std::move(array[path.back().index]);
+    array.erase(array.begin() + path.back().index);
+  }
+  return value;
+}
+
+void Patcher::apply(const Json& operation) {
+  if (!operation.is_object()) {
+    fail("not an object");
+  }
+  auto& members = operation.get_object();
+  const Json& op = member(members, "op");
+  if (!op.is_string()) {
+    fail("`op` is not a string");
+  }
+  const std::string& name = op.get_string();
+  JsonPointer path = pointer(members, "path");
+  if (name == "add") {
+    m_undo.push_back(insert(path, member(members, "value").share()));
+  } else if (name == "remove") {
+    Json value = erase(path);
+    m_undo.push_back({Undo::Kind::Insert, std::move(path), std::move(value)});
+  } else if (name == "replace") {
+    Json* target = path.find(m_json);
+    if (target == nullptr) {
+      fail("path `" + to_string(path) + "` does not exist");
+    }
+    m_undo.push_back({Undo::Kind::Assign, path, std::move(*target)});
+    *target = member(members, "value").share();
+  } else if (name == "move") {
+    JsonPointer from = pointer(members, "from");
+    existing(from);
+    if (from != path) {
+      if (from.size() < path.size() && std::equal(from.tokens().begin(), from.tokens().end(), path.tokens().begin())) {
+        fail("`" + to_string(from) + "` can't be moved into itself");
+      }
+      m_carried = erase(from);
+      m_undo.push_back({Undo::Kind::Insert, std::move(from), Json(), true});
+      m_undo.push_back(insert(path, std::move(m_carried)));
+    }
+  } else if (name == "copy") {
+    JsonPointer from = pointer(members, "from");
+    m_undo.push_back(insert(path, existing(from).share()));
+  } else if (name == "test") {
+    if (existing(path) != member(members, "value")) {
+      fail("value at `" + to_string(path) + "` differs");
+    }
+  } else {
+    fail("unknown operation `" + name + "`");
+  }
+  ++m_operation;
+}
+
+void Patcher::rollback() {
+  for (auto it = m_undo.rbegin(); it != m_undo.rend(); ++it) {
+    switch (it->kind) {
+      case Undo::Kind::Insert:
+        insert(it->path, std::move(it->carried ? m_carried : it->value));
+        break;
+      case Undo::Kind::Erase:
+        m_carried = erase(it->path);
+        break;
+      case Undo::Kind::Assign: {
+        Json& target = *it->path.find(m_json);
+        m_carried = std::move(target);
+        target = std::move(it->value);
+        break;
+      }
+    }
+  }
+  m_undo.clear();
+}
+
+// elements of an array, those of packed arrays are read in place rather than through the generic copy
+class Elements {
+ public:
+  explicit Elements(const Json& array)
+      : m_array(array), m_integers(array.packed_integers()), m_doubles(array.packed_doubles()) {}
+
+  size_t size() const { return m_array.size(); }
+  // element `index`, a packed one is stored in `scratch`
+  const Json& get(size_t index, Json& scratch) const {
+    if (m_integers) {
+      scratch = Json((*m_integers)[index]);
+      return scratch;
+    }
+    if (m_doubles) {
+      scratch = Json((*m_doubles)[index]);
+      return scratch;
+    }
+    return m_array.get_array()[index];
+  }
+
+ private:
+  const Json& m_array;
+  const std::vector<Json::Integer>* m_integers;
+  const std::vector<Json::Double>* m_doubles;
+};
+
+class Differ {
+ public:
+  explicit Differ(Json::Array& operations) : m_operations(operations) {}
+
+  void compare(const Json& from, const Json& to);
+
+ private:
+  void compare_objects(const Json::Object& from, const Json::Object& to);
+  void compare_arrays(const Elements& from, const Elements& to);
+  void compare_member(const std::string& key, const Json& from, const Json& to);
+  void compare_element(size_t index, const Json& from, const Json& to);
+
+  void add(const std::string& op, const Json* value);
+
+  Json::Array& m_operations;
+  JsonPointer m_path;
+};
+
+bool unchanged(const Json& from, const Json& to) {
+  return from.hash() == to.hash() && from == to;
+}
+
+void Differ::add(const std::string& op, const Json* value) {
+  Json::Object operation;
+  operation.emplace("op", Json(op));
+  operation.emplace("path", Json(to_string(m_path)));
+  if (value != nullptr) {
+    operation.emplace("value", value->share());
+  }
+  m_operations.emplace_back(std::move(operation));
+}
+
+void Differ::compare(const Json& from, const Json& to) {
+  if (unchanged(from, to)) {
+    return;
+  }
+  if (from.is_object() && to.is_object()) {
+    compare_objects(from.get_object(), to.get_object());
+  } else if (from.is_array() && to.is_array()) {
+    compare_arrays(Elements(from), Elements(to));
+  } else {
+    add("replace", &to);
+  }
+}
+
+void Differ::compare_member(const std::string& key, const Json& from, const Json& to) {
+  m_path.push_back(key);
+  compare(from, to);
+  m_path.pop_back();
+}
+
+void Differ::compare_element(size_t index, const Json& from, const Json& to) {
+  m_path.push_back(index);
+  compare(from, to);
+  m_path.pop_back();
+}
+
+void Differ::compare_objects(const Json::Object& from, const Json::Object& to) {
+  auto member = [this](const std::string& key, const std::string& op, const Json* value) {
+    m_path.push_back(key);
+    add(op, value);
+    m_path.pop_back();
+  };
+  if (from.order() == Json::Object::Order::Sorted && to.order() == Json::Object::Order::Sorted) {
+    // merge walk over keys in the same order
+    auto a = from.begin();
+    auto b = to.begin();
+    while (a != from.end() || b != to.end()) {
+      if (b == to.end() || (a != from.end() && a->first < b->first)) {
+        member(a->first, "remove", nullptr);
+        ++a;
+      } else if (a == from.end() || b->first < a->first) {
+        member(b->first, "add", &b->second);
+        ++b;
+      } else {
+        compare_member(a->first, a->second, b->second);
+        ++a;
+        ++b;
+      }
+    }
+    return;
+  }
+  for (auto& [key, value] : from) {
+    auto it = to.find(key);
+    if (it == to.end()) {
+      member(key, "remove", nullptr);
+    } else {
+      compare_member(key, value, it->second);
+    }
+  }
+  for (auto& [key, value] : to) {
+    if (from.find(key) == from.end()) {
+      member(key, "add", &value);
+    }
+  }
+}
+
+void Differ::compare_arrays(const Elements& from, const Elements& to) {
+  Json a;
+  Json b;
+  size_t prefix = 0;
+  size_t common = std::min(from.size(), to.size());
+  while (prefix < common && unchanged(from.get(prefix, a), to.get(prefix, b))) {
+    ++prefix;
+  }
+  size_t suffix = 0;
+  while (suffix < common - prefix &&
+         unchanged(from.get(from.size() - suffix - 1, a), to.get(to.size() - suffix - 1, b))) {
+    ++suffix;
+  }
+  size_t from_end = from.size() - suffix;
+  size_t to_end = to.size() - suffix;
+  size_t paired = std::min(from_end, to_end);
+  for (size_t i = prefix; i < paired; ++i) {
+    compare_element(i, from.get(i, a), to.get(i, b));
+  }
+  // from the back, so indices of elements still to remove do not shift
+  for (size_t i = from_end; i-- > paired;) {
+    m_path.push_back(i);
+    add("remove", nullptr);
+    m_path.pop_back();
+  }
+  for (size_t i = paired; i < to_end; ++i) {
+    m_path.push_back(i);
+    add("add", &to.get(i, b));
+    m_path.pop_back();
+  }
+}
+
+}
+
+void JSON::apply_patch(Json& json, const Json& patch) {
+  if (!patch.is_array()) {
+    throw JsonPatchException("patch is not an array", 0);
+  }
+  Patcher patcher(json);
+  try {
+    for (auto& operation : patch.get_array()) {
+      patcher.apply(operation);
+    }
+  } catch (...) {
+    patcher.rollback();
+    throw;
+  }
+}
+
+Json JSON::diff(const Json& from, const Json& to) {
+  Json::Array operations;
+  Differ(operations).compare(from, to);
+  return Json(std::move(operations));
+}
+
+void JSON::apply_merge_patch(Json& json, const Json& patch) {
+  if (!patch.is_object()) {
+    json = patch.share();
+    return;
+  }
+  if (!json.is_object()) {
+    json = Json::Object(patch.get_object().order());
+  }
+  auto& object = json.get_object();
+  for (auto& [key, value] : patch.get_object()) {
+    if (value.is_null()) {
+      object.erase(key);
+    } else {
+      apply_merge_patch(object[key], value);
+    }
+  }
+}
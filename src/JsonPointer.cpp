@@ -0,0 +1,151 @@
+#include "concise_json_schema/JsonPointer.h"
+#include "concise_json_schema/JsonException.h"
+
+#include <type_traits>
+
+using namespace JSON;
+
+namespace {
+
+// decimal without leading zeros, as required for array indices
+size_t parse_index(std::string_view key) {
+  if (key.empty() || (key.size() > 1 && key[0] == '0')) {
+    return JsonPointer::npos;
+  }
+  size_t index = 0;
+  for (char c : key) {
+    if (c < '0' || c > '9' || index > (JsonPointer::npos - 9) / 10) {
+      return JsonPointer::npos;
+    }
+    index = index * 10 + (c - '0');
+  }
+  return index;
+}
+
+// shared by the const and non-const find(), overloads of the accessors are picked by J
+template <class J, class It>
+J* resolve(It begin, It end, J& json) {
+  J* node = &json;
+  for (auto token = begin; token != end; ++token) {
+    if (node->is_object()) {
+      auto& object = node->get_object();
+      auto it = object.find(token->key);
+      if (it == object.end()) {
+        return nullptr;
+      }
+      node = &it->second;
+    } else if (node->is_array()) {
+      // npos is never below the size
+      if (token->index >= node->size()) {
+        return nullptr;
+      }
+      // elements of packed arrays are numbers, a longer path never matches, this is
+      // decided on the packed storage before get_array() builds the generic copy
+      if (std::is_const_v<J> && token + 1 != end &&
+          (node->packed_integers() || node->packed_doubles())) {
+        return nullptr;
+      }
+      node = &node->get_array()[token->index];
+    } else {
+      return nullptr;
+    }
+  }
+  return node;
+}
+
+}
+
+JsonPointer::JsonPointer(std::string_view text) {
+  if (text.empty()) {
+    return;
+  }
+  if (text[0] != '/') {
+    throw JSONParseException("JSON pointer `" + std::string(text) + "` does not start with '/'");
+  }
+  size_t pos = 1;
+  while (true) {
+    size_t end = std::min(text.find('/', pos), text.size());
+    std::string key;
+    key.reserve(end - pos);
+    for (size_t i = pos; i < end; ++i) {
+      if (text[i] != '~') {
+        key += text[i];
+      } else if (i + 1 < end && (text[i + 1] == '0' || text[i + 1] == '1')) {
+        key += text[++i] == '0' ? '~' : '/';
+      } else {
+        throw JSONParseException("bad escape in JSON pointer `" + std::string(text) + "`");
+      }
+    }
+    push_back(std::move(key));
+    if (end == text.size()) {
+      break;
+    }
+    pos = end + 1;
+  }
+}
+
+const Json* JsonPointer::find(const Json& json) const {
+  return resolve(m_tokens.begin(), m_tokens.end(), json);
+}
+
+Json* JsonPointer::find(Json& json) const {
+  return resolve(m_tokens.begin(), m_tokens.end(), json);
+}
+
+std::optional<Json> JsonPointer::get(const Json& json) const {
+  if (m_tokens.empty()) {
+    return json.share();
+  }
+  const Json* parent = resolve(m_tokens.begin(), m_tokens.end() - 1, json);
+  if (parent == nullptr) {
+    return std::nullopt;
+  }
+  size_t index = m_tokens.back().index;
+  if (auto integers = parent->packed_integers()) {
+    return index < integers->size() ? std::optional<Json>(Json((*integers)[index])) : std::nullopt;
+  }
+  if (auto doubles = parent->packed_doubles()) {
+    return index < doubles->size() ? std::optional<Json>(Json((*doubles)[index])) : std::nullopt;
+  }
+  const Json* found = resolve(m_tokens.end() - 1, m_tokens.end(), *parent);
+  if (found == nullptr) {
+    return std::nullopt;
+  }
+  return found->share();
+}
+
+JsonPointer JsonPointer::parent() const {
+  JsonPointer result;
+  if (!m_tokens.empty()) {
+    result.m_tokens.assign(m_tokens.begin(), m_tokens.end() - 1);
+  }
+  return result;
+}
+
+JsonPointer& JsonPointer::push_back(std::string key) {
+  size_t index = parse_index(key);
+  m_tokens.push_back({std::move(key), index});
+  return *this;
+}
+
+JsonPointer& JsonPointer::push_back(size_t index) {
+  m_tokens.push_back({std::to_string(index), index});
+  return *this;
+}
+
+std::string JSON::to_string(const JsonPointer& pointer) {
+  std::string result;
+  for (auto& token : pointer.tokens()) {
+    result += '/';
+    for (char c : token.key) {
+      if (c == '~') {
+        result += "~0";
+      } else if (c == '/') {
+        result += "~1";
+      } else {
+        result += c;
+      }
+    }
+  }
+  return result;
+}
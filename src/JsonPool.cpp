@@ -0,0 +1,95 @@
+#include "concise_json_schema/JsonPool.h"
+
+#include <atomic>
+#include <new>
+
+using namespace JSON;
+
+namespace {
+
+const size_t granularity = 16;
+const size_t classes = pool_max_block_size / granularity;
+
+std::atomic<bool> enabled{true};
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+// Trivially destructible, so it stays usable after the thread's destructors ran,
+// e.g. by Json objects with static storage duration.
+struct ThreadPool {
+  FreeBlock* lists[classes];
+  size_t counts[classes];
+  PoolStats stats;
+  bool registered;
+  bool finished;
+};
+
+thread_local ThreadPool pool;
+
+// returns cached blocks to the heap when the thread exits
+struct ThreadPoolGuard {
+  ~ThreadPoolGuard() {
+    trim_pool();
+    pool.finished = true;
+  }
+};
+
+size_t size_class(size_t size) { return (size + granularity - 1) / granularity - 1; }
+
+}
+
+PoolStats JSON::pool_stats() { return pool.stats; }
+
+void JSON::set_pool_enabled(bool value) { enabled.store(value, std::memory_order_relaxed); }
+
+bool JSON::pool_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+void JSON::trim_pool() {
+  for (size_t i = 0; i < classes; ++i) {
+    while (FreeBlock* block = pool.lists[i]) {
+      pool.lists[i] = block->next;
+      ::operator delete(block);
+    }
+    pool.counts[i] = 0;
+  }
+  pool.stats.cached = 0;
+  pool.stats.cached_bytes = 0;
+}
+
+void* JSON::pool_allocate(size_t size) {
+  ++pool.stats.allocated;
+  if (size > pool_max_block_size) {
+    return ::operator new(size);
+  }
+  size_t index = size_class(size);
+  if (FreeBlock* block = pool_enabled() ? pool.lists[index] : nullptr) {
+    pool.lists[index] = block->next;
+    --pool.counts[index];
+    ++pool.stats.reused;
+    --pool.stats.cached;
+    pool.stats.cached_bytes -= (index + 1) * granularity;
+    return block;
+  }
+  // whole class size, the block may be cached and reused later even if allocated while disabled
+  return ::operator new((index + 1) * granularity);
+}
+
+void JSON::pool_deallocate(void* block, size_t size) {
+  ++pool.stats.freed;
+  size_t index = size_class(size);
+  if (size > pool_max_block_size || !pool_enabled() || pool.finished || pool.counts[index] == pool_max_cached) {
+    ::operator delete(block);
+    return;
+  }
+  if (!pool.registered) {
+    static thread_local ThreadPoolGuard guard;
+    pool.registered = true;
+  }
+  pool.lists[index] = new (block) FreeBlock{pool.lists[index]};
+  ++pool.counts[index];
+  ++pool.stats.kept;
+  ++pool.stats.cached;
+  pool.stats.cached_bytes += (index + 1) * granularity;
+}
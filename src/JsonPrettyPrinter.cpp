@@ -0,0 +1,160 @@
+#include "concise_json_schema/JsonPrettyPrinter.h"
+#include "console_style/ConsoleSyle.h"
+
+#include <algorithm>
+#include <charconv>
+
+using namespace JSON;
+
+namespace {
+
+std::string quoted(std::string_view value) {
+  std::string result;
+  StringWriter writer(result);
+  writer.write_string(value);
+  writer.flush();
+  return result;
+}
+
+}
+
+PrettyPrinter::PrettyPrinter(Writer& out, int tab_size) : m_out(out), m_tab_size(tab_size) {}
+
+void PrettyPrinter::indent(size_t width) { m_out.write_spaces(width); }
+
+void PrettyPrinter::token(Token kind, std::string_view text) {
+  if (kind == Token::Key || kind == Token::String) {
+    m_out.write_string(text);
+  } else {
+    m_out.append(text.data(), text.size());
+  }
+}
+
+const Json* PrettyPrinter::element(const Json& array, size_t index) {
+  if (auto integers = array.packed_integers(); integers && !element_nodes(array)) {
+    m_element = Json((*integers)[index]);
+    return &m_element;
+  }
+  if (auto doubles = array.packed_doubles(); doubles && !element_nodes(array)) {
+    m_element = Json((*doubles)[index]);
+    return &m_element;
+  }
+  return &array.get_array()[index];
+}
+
+void PrettyPrinter::key(const std::string& name, size_t width) {
+  token(Token::Key, name);
+  indent(width - name.size());
+  m_out.append(": ", 2);
+}
+
+void PrettyPrinter::begin_value(const Json& json, int offset) {
+  if (json.is_array()) {
+    if (json.size() == 0) {
+      m_out.append("[]", 2);
+    } else {
+      m_out.append("[\n", 2);
+      m_stack.push_back(Frame{&json, offset, 0, 0, {}});
+      return;
+    }
+  } else if (json.is_object()) {
+    const Json::Object& object = json.get_object();
+    if (object.empty()) {
+      m_out.append("{}", 2);
+    } else {
+      m_out.append("{\n", 2);
+      size_t key_width = std::max_element(object.begin(), object.end(), [](auto& a, auto& b) {
+                           return a.first.size() < b.first.size();
+                         })->first.size();
+      m_stack.push_back(Frame{&json, offset, 0, key_width, object.begin()});
+      return;
+    }
+  } else if (json.is_bool()) {
+    token(Token::Literal, json.get_bool() ? "true" : "false");
+  } else if (json.is_null()) {
+    token(Token::Literal, "null");
+  } else if (auto big = json.big_integer()) {
+    token(Token::Number, *big);
+  } else if (json.is_integer()) {
+    char buffer[24];
+    char* end = std::to_chars(buffer, buffer + sizeof(buffer), json.get_integer()).ptr;
+    token(Token::Number, std::string_view(buffer, end - buffer));
+  } else if (json.is_double()) {
+    char buffer[max_double_size];
+    char* end = format_double(buffer, json.get_double());
+    token(Token::Number, std::string_view(buffer, end - buffer));
+  } else if (json.is_string()) {
+    token(Token::String, json.get_string());
+  }
+  after_value(json, offset);
+}
+
+void PrettyPrinter::print(const Json& json, int offset, bool first_line_offset) {
+  if (first_line_offset) {
+    indent(offset);
+  }
+  m_stack.clear();
+  begin_value(json, offset);
+
+  while (!m_stack.empty()) {
+    Frame& frame = m_stack.back();
+    const Json* child = nullptr;
+    int child_offset = 0;
+    if (frame.json->is_array()) {
+      if (frame.index < frame.json->size()) {
+        if (frame.index > 0) {
+          m_out.append(",\n", 2);
+        }
+        child = element(*frame.json, frame.index++);
+        child_offset = frame.offset + m_tab_size;
+        indent(child_offset);
+      }
+    } else {
+      if (frame.iter != frame.json->get_object().end()) {
+        if (frame.index++ > 0) {
+          m_out.append(",\n", 2);
+        }
+        indent(frame.offset + m_tab_size);
+        key(frame.iter->first, frame.key_width);
+        child = &frame.iter->second;
+        child_offset = frame.offset + m_tab_size + frame.key_width + 4;
+        ++frame.iter;
+      }
+    }
+
+    if (child) {
+      begin_value(*child, child_offset);
+      continue;
+    }
+
+    const Json& done = *frame.json;
+    int done_offset = frame.offset;
+    m_stack.pop_back();
+    m_out.put('\n');
+    indent(done_offset);
+    m_out.put(done.is_array() ? ']' : '}');
+    after_value(done, done_offset);
+  }
+}
+
+ConsolePrettyPrinter::ConsolePrettyPrinter(std::ostream& out, int tab_size)
+    : PrettyPrinter(m_writer, tab_size), m_stream(out), m_writer(out) {}
+
+void ConsolePrettyPrinter::token(Token kind, std::string_view text) {
+  namespace cs = ConsoleStyle;
+  m_writer.flush();
+  switch (kind) {
+    case Token::Literal:
+      m_stream << cs::bright() << text;
+      break;
+    case Token::Number:
+      m_stream << cs::white() << text;
+      break;
+    case Token::Key:
+      m_stream << cs::bright() << cs::magenta() << quoted(text);
+      break;
+    case Token::String:
+      m_stream << cs::bright() << cs::green() << quoted(text);
+      break;
+  }
+}
@@ -0,0 +1,567 @@
+#include "concise_json_schema/JsonText.h"
+#include "concise_json_schema/JsonException.h"
+#include "concise_json_schema/JsonWriter.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace JSON;
+
+namespace {
+
+inline bool is_space(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+inline bool is_structural(char c) {
+  return c == '{' || c == '}' || c == '[' || c == ']' || c == ',' || c == ':';
+}
+
+// first character which is not JSON whitespace
+const char* skip_spaces(const char* p, const char* end) {
+#if defined(__SSE2__)
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i mask = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+                                             _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))),
+                                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')),
+                                             _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))));
+    int bits = ~_mm_movemask_epi8(mask) & 0xFFFF;
+    if (bits != 0) {
+      return p + __builtin_ctz(bits);
+    }
+  }
+#endif
+  while (p != end && is_space(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+// first whitespace, control character, quote or slash (and structural character if `structural`)
+const char* find_token_end(const char* p, const char* end, bool structural) {
+#if defined(__SSE2__)
+  const __m128i control = _mm_set1_epi8(0x20);
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i slash = _mm_set1_epi8('/');
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i mask = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk),
+                                _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, slash)));
+    if (structural) {
+      // '[' and '{', ']' and '}' differ only in bit 0x20
+      __m128i brackets = _mm_or_si128(_mm_cmpeq_epi8(_mm_or_si128(chunk, _mm_set1_epi8(0x20)), _mm_set1_epi8('{')),
+                                      _mm_cmpeq_epi8(_mm_or_si128(chunk, _mm_set1_epi8(0x20)), _mm_set1_epi8('}')));
+      mask = _mm_or_si128(mask, brackets);
+      mask = _mm_or_si128(mask, _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(',')),
+                                             _mm_cmpeq_epi8(chunk, _mm_set1_epi8(':'))));
+    }
+    int bits = _mm_movemask_epi8(mask);
+    if (bits != 0) {
+      return p + __builtin_ctz(bits);
+    }
+  }
+#endif
+  for (; p != end; ++p) {
+    unsigned char c = static_cast<unsigned char>(*p);
+    if (c <= 0x20 || c == '"' || c == '/' || (structural && is_structural(c))) {
+      return p;
+    }
+  }
+  return end;
+}
+
+// first quote or backslash
+const char* find_string_end(const char* p, const char* end) {
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int bits = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+    if (bits != 0) {
+      return p + __builtin_ctz(bits);
+    }
+  }
+#endif
+  for (; p != end; ++p) {
+    if (*p == '"' || *p == '\\') {
+      return p;
+    }
+  }
+  return end;
+}
+
+class Reformatter {
+ public:
+  // tab_size < 0 means minify
+  Reformatter(Writer& out, int tab_size) : out(out), tab_size(tab_size) {}
+
+  void feed(const char* p, const char* end) {
+    while (p != end) {
+      switch (state) {
+        case State::Normal:
+          p = normal(p, end);
+          break;
+        case State::String: {
+          const char* special = find_string_end(p, end);
+          out.append(p, special - p);
+          p = special;
+          if (p != end) {
+            out.put(*p);
+            state = *p == '"' ? State::Normal : State::Escape;
+            if (state == State::Normal) {
+              after_value();
+            }
+            ++p;
+          }
+          break;
+        }
+        case State::Escape:
+          out.put(*p++);
+          state = State::String;
+          break;
+        case State::CommentOpen:
+          if (*p != '*') {
+            throw JSONParseException("expected `*`, got `" + std::string(1, *p) + "`");
+          }
+          ++p;
+          state = State::Comment;
+          break;
+        case State::Comment:
+          p = std::find(p, end, '*');
+          if (p != end) {
+            ++p;
+            state = State::CommentStar;
+          }
+          break;
+        case State::CommentStar:
+          if (*p == '/') {
+            state = State::Normal;
+            separate();
+            ++p;
+          } else if (*p != '*') {
+            state = State::Comment;
+            ++p;
+          } else {
+            ++p;
+          }
+          break;
+      }
+    }
+  }
+
+  void finish() {
+    if (state != State::Normal || !closers.empty()) {
+      throw JSONParseException("unexpected EOF");
+    }
+  }
+
+ private:
+  enum class State { Normal, String, Escape, CommentOpen, Comment, CommentStar };
+
+  const char* normal(const char* p, const char* end) {
+    char c = *p;
+    if (is_space(c)) {
+      separate();
+      return skip_spaces(p + 1, end);
+    }
+    if (c == '/') {
+      state = State::CommentOpen;
+      return p + 1;
+    }
+    if (c == '}' || c == ']') {
+      if (closers.empty() || closers.back() != c) {
+        throw JSONParseException("unexpected char `" + std::string(1, c) + "`");
+      }
+      closers.pop_back();
+      if (pending_open) {
+        pending_open = false;
+      } else {
+        newline(closers.size());
+      }
+      out.put(c);
+      after_value();
+      return p + 1;
+    }
+    begin_token();
+    if (c == '{' || c == '[') {
+      out.put(c);
+      closers += c == '{' ? '}' : ']';
+      pending_open = tab_size >= 0;
+      in_literal = false;
+      return p + 1;
+    }
+    if (c == ',') {
+      out.put(',');
+      newline(closers.size());
+      in_literal = false;
+      return p + 1;
+    }
+    if (c == ':') {
+      if (tab_size >= 0) {
+        out.append(": ", 2);
+      } else {
+        out.put(':');
+      }
+      in_literal = false;
+      return p + 1;
+    }
+    if (c == '"') {
+      out.put('"');
+      state = State::String;
+      in_literal = false;
+      return p + 1;
+    }
+    // number or literal, copied as is
+    const char* token_end = find_token_end(p + 1, end, true);
+    out.append(p, token_end - p);
+    in_literal = true;
+    return token_end;
+  }
+
+  void begin_token() {
+    if (pending_open) {
+      pending_open = false;
+      newline(closers.size());
+    }
+    if (closers.empty() && top_value_done) {
+      out.put('\n');
+      top_value_done = false;
+    }
+  }
+
+  // whitespace or comment ends a top level literal
+  void separate() {
+    if (in_literal) {
+      in_literal = false;
+      after_value();
+    }
+  }
+
+  void after_value() {
+    if (closers.empty()) {
+      top_value_done = true;
+    }
+  }
+
+  void newline(size_t level) {
+    if (tab_size < 0) {
+      return;
+    }
+    out.put('\n');
+    out.write_spaces(level * tab_size);
+  }
+
+  Writer& out;
+  int tab_size;
+  State state = State::Normal;
+  // closing brackets of the open arrays and objects, innermost last
+  std::string closers;
+  bool pending_open = false;
+  bool in_literal = false;
+  bool top_value_done = false;
+};
+
+// first quote, slash or bracket
+const char* find_structure(const char* p, const char* end) {
+#if defined(__SSE2__)
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+    __m128i mask = _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('}')));
+    mask = _mm_or_si128(mask, _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')),
+                                           _mm_cmpeq_epi8(chunk, _mm_set1_epi8('/'))));
+    int bits = _mm_movemask_epi8(mask);
+    if (bits != 0) {
+      return p + __builtin_ctz(bits);
+    }
+  }
+#endif
+  for (; p != end; ++p) {
+    char c = *p;
+    if (c == '"' || c == '/' || c == '{' || c == '}' || c == '[' || c == ']') {
+      return p;
+    }
+  }
+  return end;
+}
+
+// Finds values in JSON text by skipping over the others without parsing them
+class Scanner {
+ public:
+  explicit Scanner(std::string_view text) : p(text.data()), end(text.data() + text.size()) {}
+
+  std::string_view find(const JsonPointer& pointer) {
+    skip_space();
+    for (auto& token : pointer.tokens()) {
+      if (p == end) {
+        throw JSONParseException("unexpected EOF");
+      }
+      bool found = *p == '{' ? find_member(token.key) : *p == '[' ? find_element(token.index) : false;
+      if (!found) {
+        return {};
+      }
+    }
+    const char* begin = p;
+    skip_value();
+    return {begin, size_t(p - begin)};
+  }
+
+ private:
+  // before a member value, false if there is no such key
+  bool find_member(const std::string& key) {
+    ++p;
+    skip_space();
+    if (p != end && *p == '}') {
+      return false;
+    }
+    while (true) {
+      expect('"');
+      const char* key_begin = p;
+      skip_string();
+      bool match = key_equals(std::string_view(key_begin, p - key_begin - 1), key);
+      skip_space();
+      expect(':');
+      skip_space();
+      if (match) {
+        return true;
+      }
+      skip_value();
+      skip_space();
+      if (p != end && *p == '}') {
+        return false;
+      }
+      expect(',');
+      skip_space();
+    }
+  }
+
+  // before an array element, false if there is no such index
+  bool find_element(size_t index) {
+    ++p;
+    skip_space();
+    if (index == JsonPointer::npos || (p != end && *p == ']')) {
+      return false;
+    }
+    for (size_t i = 0; i < index; ++i) {
+      skip_value();
+      skip_space();
+      if (p != end && *p == ']') {
+        return false;
+      }
+      expect(',');
+      skip_space();
+    }
+    return true;
+  }
+
+  // `raw` is the key between quotes, as in the text
+  static bool key_equals(std::string_view raw, const std::string& key) {
+    if (raw.find('\\') == std::string_view::npos) {
+      return raw == key;
+    }
+    return unescape(raw) == key;
+  }
+
+  static std::string unescape(std::string_view raw) {
+    std::string result;
+    for (size_t i = 0; i < raw.size(); ++i) {
+      if (raw[i] != '\\') {
+        result += raw[i];
+        continue;
+      }
+      char c = raw[++i];
+      switch (c) {
+        case 'b':
+          result += '\b';
+          break;
+        case 'f':
+          result += '\f';
+          break;
+        case 'n':
+          result += '\n';
+          break;
+        case 'r':
+          result += '\r';
+          break;
+        case 't':
+          result += '\t';
+          break;
+        case 'u': {
+          uint32_t code = hex4(raw, i + 1);
+          i += 4;
+          if (code >= 0xD800 && code < 0xDC00 && i + 6 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u') {
+            uint32_t low = hex4(raw, i + 3);
+            if (low >= 0xDC00 && low < 0xE000) {
+              code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+              i += 6;
+            }
+          }
+          append_utf8(result, code);
+          break;
+        }
+        default:
+          result += c;
+      }
+    }
+    return result;
+  }
+
+  static uint32_t hex4(std::string_view raw, size_t pos) {
+    if (pos + 4 > raw.size()) {
+      throw JSONParseException("bad \\u escape");
+    }
+    uint32_t code = 0;
+    for (char c : raw.substr(pos, 4)) {
+      code <<= 4;
+      if (c >= '0' && c <= '9') {
+        code |= c - '0';
+      } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+        code |= (c | 0x20) - 'a' + 10;
+      } else {
+        throw JSONParseException("bad \\u escape");
+      }
+    }
+    return code;
+  }
+
+  void expect(char c) {
+    if (p == end) {
+      throw JSONParseException("unexpected EOF");
+    }
+    if (*p != c) {
+      throw JSONParseException("expected `" + std::string(1, c) + "`, got `" + std::string(1, *p) + "`");
+    }
+    ++p;
+  }
+
+  void skip_space() {
+    while (true) {
+      p = skip_spaces(p, end);
+      if (p != end && *p == '/') {
+        skip_comment();
+      } else {
+        return;
+      }
+    }
+  }
+
+  // after the opening quote, stops after the closing one
+  void skip_string() {
+    while (true) {
+      p = find_string_end(p, end);
+      if (p == end) {
+        throw JSONParseException("unexpected EOF");
+      }
+      if (*p++ == '"') {
+        return;
+      }
+      if (p == end) {
+        throw JSONParseException("unexpected EOF");
+      }
+      ++p;
+    }
+  }
+
+  void skip_comment() {
+    ++p;
+    expect('*');
+    while (true) {
+      p = std::find(p, end, '*');
+      if (p == end) {
+        throw JSONParseException("unexpected EOF");
+      }
+      ++p;
+      if (p != end && *p == '/') {
+        ++p;
+        return;
+      }
+    }
+  }
+
+  void skip_value() {
+    if (p == end) {
+      throw JSONParseException("unexpected EOF");
+    }
+    char c = *p;
+    if (c == '"') {
+      ++p;
+      skip_string();
+    } else if (c == '{' || c == '[') {
+      // closing brackets of the open arrays and objects, innermost last
+      std::string closers;
+      do {
+        p = find_structure(p, end);
+        if (p == end) {
+          throw JSONParseException("unexpected EOF");
+        }
+        c = *p++;
+        if (c == '"') {
+          skip_string();
+        } else if (c == '/') {
+          --p;
+          skip_comment();
+        } else if (c == '{' || c == '[') {
+          closers += c == '{' ? '}' : ']';
+        } else if (c == closers.back()) {
+          closers.pop_back();
+        } else {
+          throw JSONParseException("unexpected char `" + std::string(1, c) + "`");
+        }
+      } while (!closers.empty());
+    } else {
+      const char* token_end = find_token_end(p, end, true);
+      if (token_end == p) {
+        throw JSONParseException("unexpected char `" + std::string(1, c) + "`");
+      }
+      p = token_end;
+    }
+  }
+
+  const char* p;
+  const char* end;
+};
+
+void reformat(std::istream& in, Writer& out, int tab_size) {
+  Reformatter reformatter(out, tab_size);
+  char buffer[64 * 1024];
+  while (in) {
+    in.read(buffer, sizeof(buffer));
+    reformatter.feed(buffer, buffer + in.gcount());
+  }
+  reformatter.finish();
+}
+
+void reformat(std::string_view text, Writer& out, int tab_size) {
+  Reformatter reformatter(out, tab_size);
+  reformatter.feed(text.data(), text.data() + text.size());
+  reformatter.finish();
+}
+}
+
+void JSON::minify(std::istream& in, Writer& out) { reformat(in, out, -1); }
+
+void JSON::minify(std::string_view text, Writer& out) { reformat(text, out, -1); }
+
+void JSON::reindent(std::istream& in, Writer& out, int tab_size) { reformat(in, out, std::max(tab_size, 0)); }
+
+void JSON::reindent(std::string_view text, Writer& out, int tab_size) { reformat(text, out, std::max(tab_size, 0)); }
+
+std::string_view JSON::find_value(std::string_view text, const JsonPointer& pointer) {
+  return Scanner(text).find(pointer);
+}
+
+bool JSON::replace_value(std::string& text, const JsonPointer& pointer, std::string_view value) {
+  std::string_view found = find_value(text, pointer);
+  if (found.empty()) {
+    return false;
+  }
+  text.replace(found.data() - text.data(), found.size(), value);
+  return true;
+}
+
+bool JSON::replace_value(std::string& text, const JsonPointer& pointer, const Json& value) {
+  return replace_value(text, pointer, to_string(value));
+}
@@ -0,0 +1,716 @@
+#include "concise_json_schema/JsonWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace JSON;
+
+namespace {
+
+struct EscapeTable {
+  // 0 - as is, 'u' - \u00XX, other - two-character escape sequence
+  char escape[256] = {};
+  EscapeTable() {
+    for (int c = 0; c < 0x20; c++) {
+      escape[c] = 'u';
+    }
+    escape[int('"')] = '"';
+    escape[int('\\')] = '\\';
+    escape[int('\b')] = 'b';
+    escape[int('\f')] = 'f';
+    escape[int('\n')] = 'n';
+    escape[int('\r')] = 'r';
+    escape[int('\t')] = 't';
+  }
+};
+
+const EscapeTable escape_table;
+
+char escape_of(char c) { return escape_table.escape[static_cast<unsigned char>(c)]; }
+
+// first character which has to be escaped, or `end`
+const char* find_escape(const char* p, const char* end) {
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control = _mm_set1_epi8(0x1f);
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i mask = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+    int bits = _mm_movemask_epi8(mask);
+    if (bits != 0) {
+      return p + __builtin_ctz(bits);
+    }
+  }
+#endif
+  for (; p != end; ++p) {
+    if (escape_of(*p)) {
+      return p;
+    }
+  }
+  return end;
+}
+
+template <class Number, class Write>
+void write_packed(Writer& out, const std::vector<Number>& numbers, Write write) {
+  out.put('[');
+  for (size_t i = 0; i < numbers.size(); ++i) {
+    if (i > 0) {
+      out.put(',');
+    }
+    write(numbers[i]);
+  }
+  out.put(']');
+}
+
+size_t escaped_size(std::string_view value) {
+  size_t size = value.size() + 2;
+  const char* end = value.data() + value.size();
+  for (const char* p = find_escape(value.data(), end); p != end; p = find_escape(p + 1, end)) {
+    size += escape_of(*p) == 'u' ? 5 : 1;
+  }
+  return size;
+}
+
+size_t integer_size(Json::Integer value) {
+  char buffer[24];
+  return std::to_chars(buffer, buffer + sizeof(buffer), value).ptr - buffer;
+}
+
+}
+
+char* JSON::format_double(char* first, Json::Double value) {
+  const double upper_fixed = 1e5;
+  const double lower_fixed = 1.0 / upper_fixed;
+  if (std::isnan(value) || std::isinf(value)) {
+    throw std::runtime_error("NaN or Inf is not representative in Json format");
+  }
+  char* last = first + max_double_size;
+  if (value > upper_fixed || value < -upper_fixed || (value < lower_fixed && value > -lower_fixed)) {
+    return std::to_chars(first, last, value, std::chars_format::scientific).ptr;
+  }
+  char* end = std::to_chars(first, last, value, std::chars_format::fixed).ptr;
+  // keep it distinguishable from integer
+  if (std::find(first, end, '.') == end) {
+    *end++ = '.';
+    *end++ = '0';
+  }
+  return end;
+}
+
+void Writer::append_large(const char* data, size_t size) {
+  while (size > 0) {
+    if (m_pos == m_end) {
+      overflow(1);
+    }
+    size_t n = std::min(size, size_t(m_end - m_pos));
+    std::memcpy(m_pos, data, n);
+    m_pos += n;
+    data += n;
+    size -= n;
+  }
+}
+
+void JSON::append_utf8(std::string& out, uint32_t code) {
+  if (code < 0x80) {
+    out += char(code);
+  } else if (code < 0x800) {
+    out += char(0xC0 | (code >> 6));
+    out += char(0x80 | (code & 0x3F));
+  } else if (code < 0x10000) {
+    out += char(0xE0 | (code >> 12));
+    out += char(0x80 | ((code >> 6) & 0x3F));
+    out += char(0x80 | (code & 0x3F));
+  } else {
+    out += char(0xF0 | (code >> 18));
+    out += char(0x80 | ((code >> 12) & 0x3F));
+    out += char(0x80 | ((code >> 6) & 0x3F));
+    out += char(0x80 | (code & 0x3F));
+  }
+}
+
+void Writer::write_integer(Json::Integer value) {
+  char* first = reserve(24);
+  commit(std::to_chars(first, first + 24, value).ptr);
+}
+
+void Writer::write_double(Json::Double value) { commit(format_double(reserve(max_double_size), value)); }
+
+void Writer::write_spaces(size_t count) {
+  while (count > 0) {
+    size_t n = std::min(count, size_t(64));
+    char* first = reserve(n);
+    std::memset(first, ' ', n);
+    commit(first + n);
+    count -= n;
+  }
+}
+
+void Writer::write_string(std::string_view value) {
+  static const char hex[] = "0123456789abcdef";
+  put('"');
+  const char* p = value.data();
+  const char* end = p + value.size();
+  while (true) {
+    const char* special = find_escape(p, end);
+    if (size_t(special - p) >= m_ref_threshold) {
+      append_ref(p, special - p);
+    } else {
+      append(p, special - p);
+    }
+    if (special == end) {
+      break;
+    }
+    char escape = escape_of(*special);
+    if (escape == 'u') {
+      char* out = reserve(6);
+      unsigned char c = static_cast<unsigned char>(*special);
+      out[0] = '\\';
+      out[1] = 'u';
+      out[2] = '0';
+      out[3] = '0';
+      out[4] = hex[c >> 4];
+      out[5] = hex[c & 0xf];
+      commit(out + 6);
+    } else {
+      char* out = reserve(2);
+      out[0] = '\\';
+      out[1] = escape;
+      commit(out + 2);
+    }
+    p = special + 1;
+  }
+  put('"');
+}
+
+void Writer::write_json(const Json& json) {
+  if (auto integers = json.packed_integers()) {
+    write_packed(*this, *integers, [this](Json::Integer x) { write_integer(x); });
+  } else if (auto doubles = json.packed_doubles()) {
+    write_packed(*this, *doubles, [this](Json::Double x) { write_double(x); });
+  } else if (json.is_array()) {
+    const Json::Array& array = json.get_array();
+    put('[');
+    if (array.size() > 0) {
+      write_json(array[0]);
+      for (size_t i = 1; i < array.size(); ++i) {
+        put(',');
+        write_json(array[i]);
+      }
+    }
+    put(']');
+  } else if (json.is_bool()) {
+    if (json.get_bool()) {
+      append("true", 4);
+    } else {
+      append("false", 5);
+    }
+  } else if (auto big = json.big_integer()) {
+    append(*big);
+  } else if (json.is_integer()) {
+    write_integer(json.get_integer());
+  } else if (json.is_null()) {
+    append("null", 4);
+  } else if (json.is_object()) {
+    const Json::Object& object = json.get_object();
+    put('{');
+    auto iter = object.begin();
+    if (iter != object.end()) {
+      write_string(iter->first);
+      put(':');
+      write_json(iter->second);
+      ++iter;
+      for (; iter != object.end(); ++iter) {
+        put(',');
+        write_string(iter->first);
+        put(':');
+        write_json(iter->second);
+      }
+    }
+    put('}');
+  } else if (json.is_double()) {
+    write_double(json.get_double());
+  } else if (json.is_string()) {
+    write_string(json.get_string());
+  }
+}
+
+StringWriter::StringWriter(std::string& out) : m_out(out) {
+  size_t size = m_out.size();
+  // use already reserved capacity as a window
+  m_out.resize(m_out.capacity());
+  m_pos = &m_out[0] + size;
+  m_end = &m_out[0] + m_out.size();
+}
+
+StringWriter::~StringWriter() { flush(); }
+
+void StringWriter::flush() {
+  size_t size = m_pos - &m_out[0];
+  m_out.resize(size);
+  m_pos = m_end = &m_out[0] + size;
+}
+
+void StringWriter::overflow(size_t size) {
+  size_t used = m_pos - &m_out[0];
+  m_out.resize(std::max({m_out.size() * 2, used + size, size_t(64)}));
+  m_pos = &m_out[0] + used;
+  m_end = &m_out[0] + m_out.size();
+}
+
+StreamWriter::StreamWriter(std::ostream& out) : m_out(out) {
+  m_pos = m_buffer;
+  m_end = m_buffer + sizeof(m_buffer);
+}
+
+StreamWriter::~StreamWriter() { flush(); }
+
+void StreamWriter::flush() {
+  m_out.write(m_buffer, m_pos - m_buffer);
+  m_pos = m_buffer;
+}
+
+void StreamWriter::overflow(size_t) { flush(); }
+
+void StreamWriter::append_large(const char* data, size_t size) {
+  flush();
+  if (size < sizeof(m_buffer)) {
+    std::memcpy(m_pos, data, size);
+    m_pos += size;
+  } else {
+    m_out.write(data, size);
+  }
+}
+
+FdWriter::FdWriter(int fd, size_t chunk_size, size_t max_chunks)
+    : m_fd(fd), m_chunk_size(std::max(chunk_size, size_t(64))), m_max_chunks(std::max(max_chunks, size_t(1))) {
+  m_ref_threshold = 1024;
+  m_chunks.emplace_back(new char[m_chunk_size]);
+  m_pos = m_piece_begin = m_chunks[0].get();
+  m_end = m_pos + m_chunk_size;
+}
+
+FdWriter::~FdWriter() {
+  try {
+    flush();
+  } catch (std::system_error&) {
+  }
+}
+
+void FdWriter::close_piece() {
+  if (m_pos != m_piece_begin) {
+    m_pieces.push_back({m_piece_begin, size_t(m_pos - m_piece_begin)});
+  }
+  m_piece_begin = m_pos;
+}
+
+void FdWriter::next_chunk() {
+  close_piece();
+  if (m_chunk + 1 >= m_max_chunks) {
+    flush();
+    return;
+  }
+  ++m_chunk;
+  if (m_chunk == m_chunks.size()) {
+    m_chunks.emplace_back(new char[m_chunk_size]);
+  }
+  m_pos = m_piece_begin = m_chunks[m_chunk].get();
+  m_end = m_pos + m_chunk_size;
+}
+
+void FdWriter::overflow(size_t) { next_chunk(); }
+
+void FdWriter::append_ref(const char* data, size_t size) {
+  close_piece();
+  m_pieces.push_back({const_cast<char*>(data), size});
+  if (m_pieces.size() >= IOV_MAX) {
+    flush();
+  }
+}
+
+void FdWriter::flush() {
+  close_piece();
+  iovec* piece = m_pieces.data();
+  iovec* end = piece + m_pieces.size();
+  while (piece != end) {
+    ssize_t written = ::writev(m_fd, piece, std::min<size_t>(end - piece, IOV_MAX));
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      m_pieces.clear();
+      throw std::system_error(errno, std::generic_category(), "writev");
+    }
+    size_t n = written;
+    for (; piece != end && n >= piece->iov_len; ++piece) {
+      n -= piece->iov_len;
+    }
+    if (piece != end) {
+      piece->iov_base = static_cast<char*>(piece->iov_base) + n;
+      piece->iov_len -= n;
+    }
+  }
+  m_pieces.clear();
+  m_chunk = 0;
+  m_pos = m_piece_begin = m_chunks[0].get();
+  m_end = m_pos + m_chunk_size;
+}
+
+namespace {
+
+// Splits serialization of a document into ordered pieces: the skeleton around large containers is
+// written while planning, elements of large containers are split into ranges, which are then written
+// by a single pool of `threads` threads, so nested large containers do not start threads of their own.
+class ParallelWriter {
+ public:
+  ParallelWriter(size_t threads, size_t min_size) : m_threads(threads), m_min_size(min_size) {}
+
+  void write(Writer& out, const Json& json) {
+    plan(json);
+    m_skeleton.reset();
+    run();
+    // append() copies, writers which reference data until flush() only do so for write_string(),
+    // so the buffers may be destroyed before `out` is flushed
+    for (auto& buffer : m_buffers) {
+      out.append(buffer);
+    }
+  }
+
+ private:
+  // element `i` of a large container is written by write_element(writer, i)
+  using WriteRange = std::function<void(Writer&, size_t begin, size_t end)>;
+
+  struct Job {
+    std::string* buffer;
+    size_t begin;
+    size_t end;
+    const WriteRange* write;
+  };
+
+  Writer& skeleton() {
+    if (!m_skeleton) {
+      m_skeleton = std::make_unique<StringWriter>(m_buffers.emplace_back());
+    }
+    return *m_skeleton;
+  }
+
+  template <typename WriteElement>
+  void elements(size_t count, WriteElement write_element) {
+    const WriteRange& write = m_writers.emplace_back([write_element](Writer& writer, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        if (i > 0) {
+          writer.put(',');
+        }
+        write_element(writer, i);
+      }
+    });
+    m_skeleton.reset();
+    const size_t n_ranges = std::min(count, m_threads * 4);
+    for (size_t range = 0; range < n_ranges; ++range) {
+      m_jobs.push_back({&m_buffers.emplace_back(), count * range / n_ranges, count * (range + 1) / n_ranges, &write});
+    }
+  }
+
+  void plan(const Json& json) {
+    if (auto integers = json.packed_integers(); integers && integers->size() >= m_min_size) {
+      skeleton().put('[');
+      elements(integers->size(), [integers](Writer& writer, size_t i) { writer.write_integer((*integers)[i]); });
+      skeleton().put(']');
+    } else if (auto doubles = json.packed_doubles(); doubles && doubles->size() >= m_min_size) {
+      skeleton().put('[');
+      elements(doubles->size(), [doubles](Writer& writer, size_t i) { writer.write_double((*doubles)[i]); });
+      skeleton().put(']');
+    } else if (json.packed_integers() || json.packed_doubles()) {
+      skeleton().write_json(json);
+    } else if (json.is_array()) {
+      const Json::Array& array = json.get_array();
+      skeleton().put('[');
+      if (array.size() >= m_min_size) {
+        elements(array.size(), [&array](Writer& writer, size_t i) { writer.write_json(array[i]); });
+      } else {
+        for (size_t i = 0; i < array.size(); ++i) {
+          if (i > 0) {
+            skeleton().put(',');
+          }
+          plan(array[i]);
+        }
+      }
+      skeleton().put(']');
+    } else if (json.is_object()) {
+      const Json::Object& object = json.get_object();
+      skeleton().put('{');
+      if (object.size() >= m_min_size) {
+        auto& items = m_items.emplace_back();
+        items.reserve(object.size());
+        for (auto& x : object) {
+          items.push_back(&x);
+        }
+        elements(items.size(), [&items](Writer& writer, size_t i) {
+          writer.write_string(items[i]->first);
+          writer.put(':');
+          writer.write_json(items[i]->second);
+        });
+      } else {
+        for (auto it = object.begin(); it != object.end(); ++it) {
+          if (it != object.begin()) {
+            skeleton().put(',');
+          }
+          skeleton().write_string(it->first);
+          skeleton().put(':');
+          plan(it->second);
+        }
+      }
+      skeleton().put('}');
+    } else {
+      skeleton().write_json(json);
+    }
+  }
+
+  void run() {
+    std::atomic<size_t> next_job{0};
+    std::exception_ptr error;
+    std::atomic<bool> failed{false};
+
+    auto worker = [&]() {
+      for (size_t job = next_job++; job < m_jobs.size() && !failed; job = next_job++) {
+        try {
+          StringWriter writer(*m_jobs[job].buffer);
+          (*m_jobs[job].write)(writer, m_jobs[job].begin, m_jobs[job].end);
+        } catch (...) {
+          if (!failed.exchange(true)) {
+            error = std::current_exception();
+          }
+        }
+      }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < std::min(m_threads, m_jobs.size()); ++i) {
+      pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+      thread.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  const size_t m_threads;
+  const size_t m_min_size;
+  // deques keep addresses stable while planning
+  std::deque<std::string> m_buffers;
+  std::deque<WriteRange> m_writers;
+  std::deque<std::vector<const Json::Object::value_type*>> m_items;
+  std::vector<Job> m_jobs;
+  std::unique_ptr<StringWriter> m_skeleton;
+};
+}
+
+void JSON::write_json_parallel(Writer& out, const Json& json, size_t threads, size_t min_size) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  ParallelWriter(threads, std::max(min_size, size_t(1))).write(out, json);
+}
+
+HashWriter::HashWriter(uint64_t seed) : m_h1(seed), m_h2(seed) {
+  m_pos = m_buffer;
+  m_end = m_buffer + sizeof(m_buffer);
+}
+
+namespace {
+
+const uint64_t murmur_c1 = 0x87c37b91114253d5ull;
+const uint64_t murmur_c2 = 0x4cf5812d5ed5ae65ull;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t fmix(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdull;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ull;
+  return k ^ (k >> 33);
+}
+
+inline uint64_t load_le(const char* p, size_t size) {
+  uint64_t k = 0;
+  for (size_t i = 0; i < size; ++i) {
+    k |= uint64_t(static_cast<unsigned char>(p[i])) << (8 * i);
+  }
+  return k;
+}
+
+void murmur_blocks(uint64_t& h1, uint64_t& h2, const char* data, size_t blocks) {
+  for (size_t i = 0; i < blocks; ++i, data += 16) {
+    uint64_t k1 = load_le(data, 8);
+    uint64_t k2 = load_le(data + 8, 8);
+    h1 ^= rotl(k1 * murmur_c1, 31) * murmur_c2;
+    h1 = (rotl(h1, 27) + h2) * 5 + 0x52dce729;
+    h2 ^= rotl(k2 * murmur_c2, 33) * murmur_c1;
+    h2 = (rotl(h2, 31) + h1) * 5 + 0x38495ab5;
+  }
+}
+}
+
+void HashWriter::overflow(size_t size) {
+  if (size > sizeof(m_buffer) - 16) {
+    throw std::length_error("HashWriter: reserve is too large");
+  }
+  size_t used = m_pos - m_buffer;
+  size_t blocks = used / 16;
+  murmur_blocks(m_h1, m_h2, m_buffer, blocks);
+  m_length += blocks * 16;
+  size_t tail = used - blocks * 16;
+  std::memmove(m_buffer, m_buffer + blocks * 16, tail);
+  m_pos = m_buffer + tail;
+}
+
+HashWriter::Hash128 HashWriter::digest() const {
+  uint64_t h1 = m_h1;
+  uint64_t h2 = m_h2;
+  size_t used = m_pos - m_buffer;
+  size_t blocks = used / 16;
+  murmur_blocks(h1, h2, m_buffer, blocks);
+  const char* tail = m_buffer + blocks * 16;
+  size_t tail_size = used - blocks * 16;
+  if (tail_size > 8) {
+    h2 ^= rotl(load_le(tail + 8, tail_size - 8) * murmur_c2, 33) * murmur_c1;
+  }
+  if (tail_size > 0) {
+    h1 ^= rotl(load_le(tail, std::min(tail_size, size_t(8))) * murmur_c1, 31) * murmur_c2;
+  }
+  uint64_t length = m_length + used;
+  h1 ^= length;
+  h2 ^= length;
+  h1 += h2;
+  h2 += h1;
+  h1 = fmix(h1);
+  h2 = fmix(h2);
+  h1 += h2;
+  h2 += h1;
+  return {h1, h2};
+}
+
+void JSON::write_canonical(Writer& out, const Json& json) {
+  auto write_double = [&out](Json::Double x) { out.write_double(x == 0 ? 0.0 : x); };
+  if (auto doubles = json.packed_doubles()) {
+    write_packed(out, *doubles, write_double);
+  } else if (json.packed_integers()) {
+    out.write_json(json);
+  } else if (json.is_array()) {
+    const Json::Array& array = json.get_array();
+    out.put('[');
+    for (size_t i = 0; i < array.size(); ++i) {
+      if (i > 0) {
+        out.put(',');
+      }
+      write_canonical(out, array[i]);
+    }
+    out.put(']');
+  } else if (json.is_object()) {
+    const Json::Object& object = json.get_object();
+    std::vector<const Json::Object::value_type*> items;
+    items.reserve(object.size());
+    for (auto& x : object) {
+      items.push_back(&x);
+    }
+    if (object.order() != Json::Object::Order::Sorted) {
+      std::sort(items.begin(), items.end(), [](auto a, auto b) { return a->first < b->first; });
+    }
+    out.put('{');
+    for (size_t i = 0; i < items.size(); ++i) {
+      if (i > 0) {
+        out.put(',');
+      }
+      out.write_string(items[i]->first);
+      out.put(':');
+      write_canonical(out, items[i]->second);
+    }
+    out.put('}');
+  } else if (json.is_double()) {
+    write_double(json.get_double());
+  } else {
+    out.write_json(json);
+  }
+}
+
+std::string JSON::to_canonical_string(const Json& json) {
+  std::string result;
+  StringWriter writer(result);
+  write_canonical(writer, json);
+  writer.flush();
+  return result;
+}
+
+HashWriter::Hash128 JSON::canonical_hash(const Json& json, uint64_t seed) {
+  HashWriter writer(seed);
+  write_canonical(writer, json);
+  return writer.digest();
+}
+
+size_t JSON::serialized_size(const Json& json) {
+  if (auto integers = json.packed_integers()) {
+    size_t size = 1 + integers->size();
+    for (auto x : *integers) {
+      size += integer_size(x);
+    }
+    return size;
+  } else if (auto doubles = json.packed_doubles()) {
+    size_t size = 1 + doubles->size();
+    char buffer[max_double_size];
+    for (auto x : *doubles) {
+      size += format_double(buffer, x) - buffer;
+    }
+    return size;
+  } else if (json.is_array()) {
+    const Json::Array& array = json.get_array();
+    size_t size = 2 + (array.empty() ? 0 : array.size() - 1);
+    for (auto& x : array) {
+      size += serialized_size(x);
+    }
+    return size;
+  } else if (json.is_bool()) {
+    return json.get_bool() ? 4 : 5;
+  } else if (auto big = json.big_integer()) {
+    return big->size();
+  } else if (json.is_integer()) {
+    return integer_size(json.get_integer());
+  } else if (json.is_null()) {
+    return 4;
+  } else if (json.is_object()) {
+    const Json::Object& object = json.get_object();
+    size_t size = 2 + (object.empty() ? 0 : object.size() - 1);
+    for (auto& x : object) {
+      size += escaped_size(x.first) + 1 + serialized_size(x.second);
+    }
+    return size;
+  } else if (json.is_double()) {
+    char buffer[max_double_size];
+    return format_double(buffer, json.get_double()) - buffer;
+  } else {
+    return escaped_size(json.get_string());
+  }
+}
@@ -1,7 +1,11 @@
 #include "concise_json_schema/Schema.h"
+#include "concise_json_schema/JsonPrettyPrinter.h"
+#include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <iomanip>
+#include <functional>
+#include <sstream>
+#include <unordered_set>
 #include "console_style/ConsoleSyle.h"
 
 namespace cs = ConsoleStyle;
@@ -9,6 +13,13 @@ using namespace JSON;
 
 namespace {
 
+// range check of packed array elements, same comparisons as IntSchema and DoubleSchema
+template <class Number, class Bound>
+bool in_bounds(const std::vector<Number>& numbers, const Bound& min, const Bound& max) {
+  return std::all_of(numbers.begin(), numbers.end(),
+                     [&](Number x) { return !(min && x < min.value()) && !(max && x > max.value()); });
+}
+
 struct reference_visiter {
   bool is_extended;
   const Json& json;
@@ -129,107 +140,86 @@ void pretty_print(std::ostream& out, const SchemaMatchResult::MatchError& error,
   }
 }
 
-void pretty_print(
-    const Json& json, std::ostream& out, int tab_size, int offset, bool first_line_offset,
-    const std::map<const Json*, std::vector<std::pair<int, const SchemaMatchResult::MatchError*>>>& comments) {
-  namespace cs = ConsoleStyle;
-  if (first_line_offset) {
-    out << std::string(offset, ' ');
+using Comments = std::map<const Json*, std::vector<std::pair<int, const SchemaMatchResult::MatchError*>>>;
+
+// error lines below a value printed at indentation `offset`, the schema part is yellow if `styled`
+void write_comments(std::ostream& out, const Comments::mapped_type& lines, int offset, int tab_size, bool styled) {
+  int base_level = lines.front().first;
+  out << "\n" << std::string(offset, ' ');
+  out << std::string(8, '^') << "\n";
+  for (auto& comment : lines) {
+    assert(comment.second->schema != nullptr);
+    out << std::string(offset + 2 * tab_size * (comment.first - base_level), ' ');
+    out << comment.second->what();
+    if (styled) {
+      out << cs::yellow();
+    }
+    out << " //" << *comment.second->schema << std::endl;
   }
-  if (json.is_array()) {
-    const Json::Array& array = json.get_array();
-    out << "[";
-    if (array.size() > 0) {
-      out << "\n";
-      pretty_print(array[0], out, tab_size, offset + tab_size, true, comments);
-      for (size_t i = 1; i < array.size(); ++i) {
-        out << ",\n";
-        pretty_print(array[i], out, tab_size, offset + tab_size, true, comments);
-      }
-      out << "\n";
-      out << std::string(offset, ' ');
+  out << std::string(offset, ' ');
+}
+
+// prints json with match errors attached to the values they refer to
+class AnnotatingPrettyPrinter : public ConsolePrettyPrinter {
+ public:
+  AnnotatingPrettyPrinter(std::ostream& out, int tab_size, const Comments& comments)
+      : ConsolePrettyPrinter(out, tab_size), comments(comments) {}
+
+ protected:
+  void after_value(const Json& json, int offset) override {
+    auto it = comments.find(&json);
+    if (it == comments.end()) {
+      return;
     }
-    out << ']';
-  } else if (json.is_bool()) {
-    out << cs::bright() << (json.get_bool() ? "true" : "false");
-  } else if (json.is_integer()) {
-    out << cs::white() << json.get_integer();
-  } else if (json.is_null()) {
-    out << cs::bright() << "null";
-  } else if (json.is_object()) {
-    const Json::Object& object = json.get_object();
-    out << "{";
-    auto iter = object.begin();
-    if (iter != object.end()) {
-      out << "\n";
-      int maxKeyLength = object.empty() ? 0ul : std::max_element(object.begin(), object.end(), [](auto& a, auto& b) {
-                                                  return a.first.size() < b.first.size();
-                                                })->first.size();
-      out << std::string(offset + tab_size, ' ');
-      out << cs::bright() << cs::magenta() << "\"" << iter->first << "\""
-          << std::string(maxKeyLength - iter->first.size(), ' ');
-      out << ": ";
-      pretty_print(iter->second, out, tab_size, offset + tab_size + maxKeyLength + 4, false, comments);
-      ++iter;
-      for (; iter != object.end(); ++iter) {
-        out << ",\n";
-        out << std::string(offset + tab_size, ' ');
-        out << cs::bright() << cs::magenta() << "\"" << iter->first << "\""
-            << std::string(maxKeyLength - iter->first.size(), ' ');
-        out << ": ";
-        pretty_print(iter->second, out, tab_size, offset + tab_size + maxKeyLength + 4, false, comments);
-      }
-      out << "\n";
-      out << std::string(offset, ' ');
+    m_writer.flush();
+    SET_SCOPED_CONSOLE_STYLE(m_stream, cs::red())
+    write_comments(m_stream, it->second, offset, m_tab_size, true);
+  }
+  // errors of packed array elements refer to the generic copy, built when they were matched
+  bool element_nodes(const Json& array) const override { return comments.count(&array) != 0; }
+
+ private:
+  const Comments& comments;
+};
+
+// same as AnnotatingPrettyPrinter, without console styles
+class PlainAnnotatingPrettyPrinter : public PrettyPrinter {
+ public:
+  PlainAnnotatingPrettyPrinter(Writer& out, int tab_size, const Comments& comments)
+      : PrettyPrinter(out, tab_size), comments(comments) {}
+
+ protected:
+  void after_value(const Json& json, int offset) override {
+    auto it = comments.find(&json);
+    if (it == comments.end()) {
+      return;
     }
-    out << '}';
-  } else if (json.is_double()) {
-    SET_SCOPED_CONSOLE_STYLE(out, cs::white());
-    const double upper_fixed = 1e5;
-    const double lower_fixed = 1.0 / upper_fixed;
-    double d = json.get_double();
-    if (std::isnan(d) || std::isinf(d)) {
-      throw std::runtime_error("nan/inf are not representative in Json format");
-    }
-    if (d > upper_fixed || d < -upper_fixed || (d < lower_fixed && d > -lower_fixed)) {
-      std::ostringstream stream;
-      stream << std::scientific << std::setprecision(14) << json.get_double();
-      std::string value = stream.str();
-      auto epos = value.rfind('e');
-      auto pos = epos - 1;
-      while (pos > 0 && value[pos - 1] == '0') {
-        pos--;
-      }
-      if (value[pos - 1] == '.') {
-        pos--;
-      }
-      out << value.substr(0, pos);
-      out << value.substr(epos);
-    } else {
-      std::ostringstream stream;
-      stream << std::fixed << std::setprecision(14) << json.get_double();
-      std::string value = stream.str();
-      while (value.size() > 1 && value[value.size() - 2] != '.' && value[value.size() - 1] == '0') {
-        value.resize(value.size() - 1);
-      }
-      out << value;
-    }
-  } else if (json.is_string()) {
-    out << cs::bright() << cs::green() << '"' << json.get_string() << '"';
-  }
-  if (comments.count(&json)) {
-    auto& lines = comments.at(&json);
-    SET_SCOPED_CONSOLE_STYLE(out, cs::red())
-    int base_level = lines.front().first;
-    out << "\n" << std::string(offset, ' ');
-    out << std::string(8, '^') << "\n";
-    for (auto& comment : lines) {
-      assert(comment.second->schema != nullptr);
-      out << std::string(offset + 2 * tab_size * (comment.first - base_level), ' ');
-      out << comment.second->what() << cs::yellow() << " //" << *comment.second->schema << std::endl;
+    std::ostringstream text;
+    write_comments(text, it->second, offset, m_tab_size, false);
+    m_out.append(text.str());
+  }
+  bool element_nodes(const Json& array) const override { return comments.count(&array) != 0; }
+
+ private:
+  const Comments& comments;
+};
+
+// match errors of `error` and its nested errors, keyed by the values they refer to
+Comments collect_comments(const SchemaMatchResult::MatchError& error) {
+  std::vector<std::pair<int, const SchemaMatchResult::MatchError*>> queue;
+  Comments comments;
+  queue.emplace_back(0, &error);
+
+  while (!queue.empty()) {
+    int level = queue.back().first;
+    const SchemaMatchResult::MatchError& m = *queue.back().second;
+    queue.pop_back();
+    comments[m.json].emplace_back(level, &m);
+    for (auto& x : m.nested) {
+      queue.emplace_back(level + 1, &x);
     }
-    out << std::string(offset, ' ');
   }
+  return comments;
 }
 }
 
@@ -264,20 +254,11 @@ SchemaMatchResult::MatchError::MatchError(const Json& json, const std::string& w
     : runtime_error(what), json(&json), nested{std::move(matchError)} {}
 
 void SchemaMatchResult::MatchError::pretty_wordy_print(std::ostream& out, int tab_size, int offset) const {
-  std::vector<std::pair<int, const MatchError*>> queue;
-  std::map<const Json*, std::vector<std::pair<int, const MatchError*>>> comments;
-  queue.emplace_back(0, this);
+  AnnotatingPrettyPrinter(out, tab_size, collect_comments(*this)).print(*json, offset, true);
+}
 
-  while (!queue.empty()) {
-    int level = queue.back().first;
-    const MatchError& m = *queue.back().second;
-    queue.pop_back();
-    comments[m.json].emplace_back(level, &m);
-    for (auto& x : m.nested) {
-      queue.emplace_back(level + 1, &x);
-    }
-  }
-  pretty_print(*json, out, tab_size, offset, true, comments);
+void SchemaMatchResult::MatchError::pretty_wordy_print(Writer& out, int tab_size, int offset) const {
+  PlainAnnotatingPrettyPrinter(out, tab_size, collect_comments(*this)).print(*json, offset, true);
 }
 
 SchemaMatchResult Schema::AllOfSchema::match(const Json& json) const {
@@ -321,7 +302,18 @@ SchemaMatchResult Schema::ArraySchema::match(const Json& json) const {
   }
 
   if (items_schema) {
-    for (size_t i = 0; i < json.size(); i++) {
+    // packed numbers are checked in place, elements are visited only to report an error
+    bool checked = false;
+    auto integers = json.packed_integers();
+    auto doubles = json.packed_doubles();
+    if (auto schema = std::get_if<IntSchema>(&items_schema->m_schema); schema && integers) {
+      checked = in_bounds(*integers, schema->min, schema->max);
+    } else if (auto schema = std::get_if<DoubleSchema>(&items_schema->m_schema); schema && integers) {
+      checked = in_bounds(*integers, schema->min, schema->max);
+    } else if (auto schema = std::get_if<DoubleSchema>(&items_schema->m_schema); schema && doubles) {
+      checked = in_bounds(*doubles, schema->min, schema->max);
+    }
+    for (size_t i = 0; !checked && i < json.size(); i++) {
       auto m = items_schema->match(json[i]);
       if (!m) {
         return SchemaMatchResult::MatchError(json, "array: bad item[ " + std::to_string(i) + " ]",
@@ -330,13 +322,26 @@ SchemaMatchResult Schema::ArraySchema::match(const Json& json) const {
     }
   }
 
-  if (unique) {
-    auto x = json.get_array();
+  if (unique && json.packed_integers()) {
+    auto x = *json.packed_integers();
+    std::sort(x.begin(), x.end());
+    if (std::adjacent_find(x.begin(), x.end()) != x.end()) {
+      return SchemaMatchResult::MatchError(json, "array: items are not unique");
+    }
+  } else if (unique && json.packed_doubles()) {
+    auto x = *json.packed_doubles();
     std::sort(x.begin(), x.end());
-    auto e = std::unique(x.begin(), x.end());
-    if (e != x.end()) {
+    if (std::adjacent_find(x.begin(), x.end()) != x.end()) {
       return SchemaMatchResult::MatchError(json, "array: items are not unique");
     }
+  } else if (unique) {
+    std::unordered_set<std::reference_wrapper<const Json>, std::hash<Json>, std::equal_to<Json>> items;
+    items.reserve(json.size());
+    for (auto& x : json.get_array()) {
+      if (!items.insert(x).second) {
+        return SchemaMatchResult::MatchError(json, "array: items are not unique");
+      }
+    }
   }
 
   return SchemaMatchResult{};
@@ -348,8 +353,9 @@ SchemaMatchResult Schema::BoolSchema::match(const Json& json) const {
   return SchemaMatchResult{};
 }
 SchemaMatchResult Schema::EnumSchema::match(const Json& json) const {
+  uint64_t hash = json.hash();
   for (auto& x : enumeration) {
-    if (json == x) {
+    if (hash == x.hash() && json == x) {
       return SchemaMatchResult{};
     }
   }
@@ -373,6 +379,16 @@ SchemaMatchResult Schema::IntSchema::match(const Json& json) const {
   if (!json.is_integer()) {
     return SchemaMatchResult::MatchError(json, "int: not an integer");
   }
+  if (auto big = json.big_integer()) {
+    // out of range of any bound on its side
+    if ((*big)[0] == '-' && min) {
+      return SchemaMatchResult::MatchError(json, "int: value (" + *big + ")< min (" + std::to_string(min.value()) + ")");
+    }
+    if ((*big)[0] != '-' && max) {
+      return SchemaMatchResult::MatchError(json, "int: value (" + *big + ")> max (" + std::to_string(max.value()) + ")");
+    }
+    return SchemaMatchResult{};
+  }
   if (min && json.get_integer() < min.value()) {
     return SchemaMatchResult::MatchError(
         json, "int: value (" + std::to_string(json.get_integer()) + ")< min (" + std::to_string(min.value()) + ")");
@@ -515,7 +531,7 @@ Json Schema::AllOfSchema::asJsonSchema() const {
 Json Schema::AnySchema::asJsonSchema() const { return Json(Json::Object{}); }
 Json Schema::AnyOfSchema::asJsonSchema() const {
   Json result;
-  result = std::map<std::string, Json>{};
+  result = Json::Object{};
   result("anyOf") = std::vector<Json>{};
   for (auto& x : items) {
     result("anyOf").push_back(x.asJsonSchema());
@@ -524,7 +540,7 @@ Json Schema::AnyOfSchema::asJsonSchema() const {
 }
 Json Schema::ArraySchema::asJsonSchema() const {
   Json result;
-  result = std::map<std::string, Json>{};
+  result = Json::Object{};
   result("type") = "array";
   result("items") = items_schema->asJsonSchema();
 
@@ -541,13 +557,13 @@ Json Schema::ArraySchema::asJsonSchema() const {
 }
 Json Schema::BoolSchema::asJsonSchema() const {
   Json result;
-  result = std::map<std::string, Json>{};
+  result = Json::Object{};
   result("type") = "boolean";
   return std::move(result);
 }
 Json Schema::EnumSchema::asJsonSchema() const {
   Json result;
-  result = std::map<std::string, Json>{};
+  result = Json::Object{};
   result("enum") = enumeration;
   return std::move(result);
 }
@@ -565,7 +581,7 @@ Json Schema::DoubleSchema::asJsonSchema() const {
 }
 Json Schema::IntSchema::asJsonSchema() const {
   Json result;
-  result = std::map<std::string, Json>{};
+  result = Json::Object{};
   result("type") = "integer";
   if (min) {
     result("minimum") = Json(min.value());
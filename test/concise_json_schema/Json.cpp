@@ -2,6 +2,13 @@
 
 #include "concise_json_schema/Json.h"
 #include "concise_json_schema/JsonException.h"
+#include "concise_json_schema/JsonInterner.h"
+#include "concise_json_schema/JsonWriter.h"
+
+#include <cmath>
+#include <tuple>
+#include <thread>
+#include <unordered_set>
 
 using ::testing::Test;
 using namespace JSON;
@@ -354,3 +361,377 @@ TEST_F(JsonTests, write_read_json)
   }
 
 }
+
+TEST_F(JsonTests, parse_error_location)
+{
+  try {
+    "[1,\n 2,\n 3 4]"_json;
+    FAIL();
+  } catch (JSONParseException& e) {
+    ASSERT_TRUE(e.has_location());
+    EXPECT_EQ(e.offset(), 11);
+    EXPECT_EQ(e.line(), 3);
+    EXPECT_EQ(e.column(), 4);
+    EXPECT_NE(std::string(e.what()).find("line 3, column 4"), std::string::npos);
+  }
+  try {
+    "{\"a\":\n\"abra"_json;
+    FAIL();
+  } catch (JSONParseException& e) {
+    ASSERT_TRUE(e.has_location());
+    EXPECT_EQ(e.offset(), 11);
+    EXPECT_EQ(e.line(), 2);
+    EXPECT_EQ(e.column(), 6);
+  }
+  {
+    std::istringstream in("[true] [tru]");
+    Json json;
+    in >> json;
+    try {
+      in >> json;
+      FAIL();
+    } catch (JSONParseException& e) {
+      EXPECT_EQ(e.offset(), 11);
+      EXPECT_EQ(e.line(), 1);
+      EXPECT_EQ(e.column(), 12);
+    }
+  }
+}
+
+TEST_F(JsonTests, object_keys_sorted) {
+  auto json = R"({"b": 1, "a": {"y": 2, "x": 3}, "c": 4, "b": 5})"_json;
+  EXPECT_EQ(to_string(json), R"({"a":{"x":3,"y":2},"b":5,"c":4})");
+  EXPECT_EQ(json.size(), 3);
+  EXPECT_EQ(json("b"), Json(5));
+  EXPECT_THROW(static_cast<const Json&>(json)("d"), JSONRangeException);
+
+  Json::Object& object = json.get_object();
+  EXPECT_EQ(object.count("a"), 1);
+  EXPECT_EQ(object.count("ab"), 0);
+  EXPECT_FALSE(object.emplace("c", Json(7)).second);
+  EXPECT_TRUE(object.emplace("0", Json(7)).second);
+  object["bb"] = Json(8);
+  EXPECT_EQ(object.erase("c"), 1);
+  EXPECT_EQ(object.erase("c"), 0);
+  EXPECT_EQ(to_string(json), R"({"0":7,"a":{"x":3,"y":2},"b":5,"bb":8})");
+
+  Json::Object literal{{"z", Json(1)}, {"k", Json(2)}, {"z", Json(3)}};
+  EXPECT_EQ(Json(literal), R"({"k":2,"z":3})"_json);
+}
+
+TEST_F(JsonTests, object_insertion_order) {
+  ParseOptions options;
+  options.preserve_key_order = true;
+  std::string text = R"({"b":1,"a":{"y":2,"x":3},"c":4,"b":5})";
+  Json json = parse(text, options);
+  EXPECT_EQ(to_string(json), R"({"b":5,"a":{"y":2,"x":3},"c":4})");
+  EXPECT_EQ(json, parse(text));
+  EXPECT_FALSE(json < parse(text));
+  EXPECT_FALSE(parse(text) < json);
+
+  // wide object with hash index
+  std::string wide = "{";
+  for (int i = 1000; i > 0; --i) {
+    wide += "\"k" + std::to_string(i) + "\":" + std::to_string(i) + (i > 1 ? "," : "}");
+  }
+  Json object = parse(wide, options);
+  EXPECT_EQ(to_string(object), wide);
+  for (int i = 1; i <= 1000; ++i) {
+    EXPECT_EQ(object("k" + std::to_string(i)), Json(i));
+  }
+  EXPECT_EQ(object.count("k0"), 0);
+  Json::Object& members = object.get_object();
+  EXPECT_EQ(members.erase("k500"), 1);
+  EXPECT_EQ(members.count("k500"), 0);
+  EXPECT_EQ(members.at("k499"), Json(499));
+  members["k0"] = Json(0);
+  EXPECT_EQ((members.end() - 1)->first, "k0");
+  EXPECT_EQ(members.size(), 1000);
+}
+
+TEST_F(JsonTests, object_stable_references) {
+  for (auto order : {Json::Object::Order::Sorted, Json::Object::Order::Insertion}) {
+    Json json{Json::Object(order)};
+    json("b") = Json("value of b");
+    // the right side is evaluated first, inserting "a" must not move it
+    json("a") = json("b");
+    EXPECT_EQ(json("a"), Json("value of b"));
+
+    Json& b = json("b");
+    for (int i = 0; i < 100; ++i) {
+      json.insert("k" + std::to_string(i), b);
+    }
+    EXPECT_EQ(&b, &json("b"));
+    EXPECT_EQ(json("k99"), Json("value of b"));
+    json.get_object().erase("a");
+    EXPECT_EQ(b, Json("value of b"));
+  }
+}
+
+TEST_F(JsonTests, compact_node) {
+  EXPECT_LE(sizeof(Json), 16);
+
+  // assignment from a part of itself
+  auto json = R"({"a":[1,{"b":"text"}]})"_json;
+  json = json("a")[1];
+  EXPECT_EQ(json, R"({"b":"text"})"_json);
+  json = std::move(json("b"));
+  EXPECT_EQ(json, Json("text"));
+
+  Json copy = json;
+  copy.get_string() += "!";
+  EXPECT_EQ(json.get_string(), "text");
+  EXPECT_TRUE(Json(1) < Json(Json::Nil{}));
+  EXPECT_TRUE(Json(1.5) < Json("a"));
+}
+
+TEST_F(JsonTests, packed_arrays) {
+  auto json = R"({"i":[1,-2,3],"d":[0.5,1e300],"mixed":[1,2.5],"other":[1,null]})"_json;
+  const Json& view = json;
+  ASSERT_NE(view("i").packed_integers(), nullptr);
+  EXPECT_EQ(*view("i").packed_integers(), (std::vector<Json::Integer>{1, -2, 3}));
+  ASSERT_NE(view("d").packed_doubles(), nullptr);
+  EXPECT_EQ(view("mixed").packed_doubles(), nullptr);
+  EXPECT_EQ(view("other").packed_integers(), nullptr);
+  EXPECT_EQ(to_string(json), R"({"d":[0.5,1e+300],"i":[1,-2,3],"mixed":[1,2.5],"other":[1,null]})");
+  EXPECT_EQ(serialized_size(json), to_string(json).size());
+
+  // const access keeps packed storage
+  EXPECT_EQ(view("i")[1], Json(-2));
+  EXPECT_EQ(view("i").size(), 3);
+  EXPECT_EQ(view("i"), Json(Json::Array{Json(1), Json(-2), Json(3)}));
+  EXPECT_NE(view("i").packed_integers(), nullptr);
+
+  // mutable access converts
+  json("i").push_back(Json("x"));
+  EXPECT_EQ(view("i").packed_integers(), nullptr);
+  EXPECT_EQ(to_string(view("i")), R"([1,-2,3,"x"])");
+
+  ParseOptions options;
+  options.pack_numeric_arrays = false;
+  EXPECT_EQ(parse("[1,2]", options).packed_integers(), nullptr);
+  EXPECT_EQ(parse("[1,2]", options), parse("[1,2]"));
+}
+
+TEST_F(JsonTests, copy_on_write) {
+  auto original = R"({"a":{"b":[1,"x",{"c":null}]},"d":[1,2,3],"s":"text"})"_json;
+  const std::string text = to_string(original);
+
+  Json copy = original.share();
+  EXPECT_EQ(copy, original);
+  copy("a")("b")[2]("c") = "changed";
+  copy("d").push_back(Json(4));
+  copy("s").get_string() += "!";
+  copy.get_object().erase("missing");
+  EXPECT_EQ(to_string(original), text);
+  EXPECT_EQ(to_string(copy), R"({"a":{"b":[1,"x",{"c":"changed"}]},"d":[1,2,3,4],"s":"text!"})");
+
+  Json second = copy.share();
+  second = original.share();
+  EXPECT_EQ(second, original);
+  original("a") = Json(1);
+  EXPECT_EQ(to_string(second), text);
+
+  // plain copies are deep, shared copies of values with outstanding references copy those parts
+  auto doc = R"({"x":{"y":1},"z":[1,2]})"_json;
+  Json& x = doc("x");
+  Json snapshot = doc;
+  Json shared = doc.share();
+  x("y") = Json(2);
+  EXPECT_EQ(to_string(snapshot), R"({"x":{"y":1},"z":[1,2]})");
+  EXPECT_EQ(to_string(shared), R"({"x":{"y":1},"z":[1,2]})");
+  EXPECT_EQ(to_string(doc), R"({"x":{"y":2},"z":[1,2]})");
+  Json::Array& z = shared("z").get_array();
+  Json::Array items;
+  items.push_back(std::move(shared));
+  Json nested(std::move(items));
+  Json outer = nested.share();
+  z.push_back(Json(3));
+  EXPECT_EQ(to_string(outer), R"([{"x":{"y":1},"z":[1,2]}])");
+
+  // snapshots modified on several threads
+  std::vector<std::thread> threads;
+  std::vector<Json> snapshots;
+  for (int i = 0; i < 4; ++i) {
+    snapshots.push_back(second.share());
+  }
+  for (size_t i = 0; i < snapshots.size(); ++i) {
+    threads.emplace_back([&snapshots, i]() {
+      for (int k = 0; k < 1000; ++k) {
+        Json snapshot = snapshots[i].share();
+        snapshot("a")("b").push_back(Json(k));
+        snapshots[i] = snapshot.share();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto& snapshot : snapshots) {
+    EXPECT_EQ(snapshot("a")("b").size(), 1003);
+  }
+  EXPECT_EQ(to_string(second), text);
+}
+
+TEST_F(JsonTests, interning) {
+  std::string text = "[";
+  for (int i = 0; i < 100; ++i) {
+    text += R"({"device":{"model":"x1","tags":["a","b"]},"unit":"ms","value":)" + std::to_string(i % 3) + "},";
+  }
+  text += "-0.0,0.0]";
+
+  Interner interner;
+  ParseOptions options;
+  options.interner = &interner;
+  Json json = parse(text, options);
+  EXPECT_EQ(json, parse(text));
+  // device, tags, "x1", "a", "b", "ms", 3 distinct records, top level array
+  EXPECT_EQ(interner.size(), 10);
+  EXPECT_EQ(to_string(json[99]), R"({"device":{"model":"x1","tags":["a","b"]},"unit":"ms","value":0})");
+  EXPECT_NE(json[0], json[1]);
+  EXPECT_EQ(json[0], json[3]);
+  EXPECT_EQ(to_string(json[100]), "-0e+00");
+
+  // modification does not leak into shared copies
+  json[3]("unit") = "s";
+  EXPECT_EQ(json[0]("unit"), Json("ms"));
+  EXPECT_NE(json[0], json[3]);
+
+  Json built(Json::Array{Json(Json::Object{{"unit", Json("ms")}}), Json(Json::Object{{"unit", Json("ms")}})});
+  interner.intern(built);
+  EXPECT_EQ(built[0], built[1]);
+  EXPECT_EQ(interner.size(), 12);
+
+  // values interned before clear() are not compared by address with later ones
+  Json before = parse(R"({"unit":"ms"})", options);
+  interner.clear();
+  Json after = parse(R"({"unit":"ms"})", options);
+  EXPECT_EQ(interner.size(), 2);
+  EXPECT_EQ(before, after);
+  EXPECT_EQ(before.get_object(), after.get_object());
+
+  // values kept apart by interning are still equal
+  ParseOptions ordered = options;
+  ordered.preserve_key_order = true;
+  ParseOptions generic = options;
+  generic.pack_numeric_arrays = false;
+  for (auto [text_a, text_b, options_b] : {std::tuple{"[[0.0]]", "[[-0.0]]", options},
+                                           std::tuple{R"({"a":1,"b":2})", R"({"b":2,"a":1})", ordered},
+                                           std::tuple{"[[1,2]]", "[[1,2]]", generic}}) {
+    Json a = parse(text_a, options);
+    Json b = parse(text_b, options_b);
+    EXPECT_EQ(a, b) << text_a << " " << text_b;
+    EXPECT_EQ(b, a) << text_a << " " << text_b;
+    EXPECT_EQ(to_string(b), to_string(parse(text_b, options_b)));
+  }
+}
+
+TEST_F(JsonTests, structural_hash) {
+  auto a = R"({"x":[1,2,3],"y":{"z":"text","w":0.0}})"_json;
+  ParseOptions options;
+  options.preserve_key_order = true;
+  options.pack_numeric_arrays = false;
+  Json b = parse(R"({"y":{"w":-0.0,"z":"text"},"x":[1,2,3]})", options);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(a.hash(), b.hash());
+  EXPECT_NE(Json(1).hash(), Json(1.0).hash());
+  EXPECT_NE(R"([1,2])"_json.hash(), R"([2,1])"_json.hash());
+
+  // cache is reset by mutation
+  uint64_t before = a.hash();
+  a("y")("z") = "other";
+  EXPECT_NE(a.hash(), before);
+  EXPECT_NE(a, b);
+
+  // a reference taken before hashing still changes the value
+  auto doc = R"({"a":[1,2],"b":{"c":"d"}})"_json;
+  Json& items = doc("a");
+  Json copy = doc;
+  uint64_t hash = doc.hash();
+  EXPECT_EQ(copy.hash(), hash);
+  items.push_back(Json(3));
+  EXPECT_NE(doc.hash(), hash);
+  EXPECT_NE(doc, copy);
+  EXPECT_NE(copy, doc);
+  items.get_array().pop_back();
+  EXPECT_EQ(doc.hash(), hash);
+  EXPECT_EQ(doc, copy);
+  a("y")("z") = "text";
+  EXPECT_EQ(a.hash(), before);
+  EXPECT_EQ(a, b);
+
+  std::unordered_set<Json> set{a, b, Json("text"), Json(Json::Array{})};
+  EXPECT_EQ(set.size(), 3);
+  EXPECT_EQ(set.count(R"({"x":[1,2,3],"y":{"w":0.0,"z":"text"}})"_json), 1);
+}
+
+TEST_F(JsonTests, big_integers) {
+  const char* text = R"([9223372036854775807,9223372036854775808,-9223372036854775809,123456789012345678901234567890])";
+  Json json = parse(text);
+  EXPECT_EQ(json.packed_integers(), nullptr);
+  EXPECT_EQ(json[0].get_integer(), INT64_MAX);
+  EXPECT_EQ(json[0].big_integer(), nullptr);
+  ASSERT_NE(json[1].big_integer(), nullptr);
+  EXPECT_EQ(*json[1].big_integer(), "9223372036854775808");
+  EXPECT_TRUE(json[1].is_integer());
+  EXPECT_TRUE(json[1].is_number());
+  EXPECT_THROW(json[1].get_integer(), JsonGetException);
+  EXPECT_DOUBLE_EQ(json[1].get_number(), 9223372036854775808.0);
+  EXPECT_DOUBLE_EQ(json[3].get_number(), 1.2345678901234568e29);
+
+  EXPECT_EQ(to_string(json), text);
+  EXPECT_EQ(serialized_size(json), strlen(text));
+  Json copy = json;
+  EXPECT_EQ(copy, json);
+  EXPECT_EQ(copy.hash(), json.hash());
+  EXPECT_EQ(parse("18446744073709551616"), parse("18446744073709551616"));
+  EXPECT_NE(parse("18446744073709551616"), parse("18446744073709551617"));
+  EXPECT_NE(parse("18446744073709551616"), parse("18446744073709551616.0"));
+
+  auto sorted = parse("[1e30, 99999999999999999999, -99999999999999999999, -100000000000000000000, 5, -5, "
+                      "100000000000000000000]")
+                    .get_array();
+  std::sort(sorted.begin(), sorted.end());
+  EXPECT_EQ(to_string(Json(sorted)),
+            "[-100000000000000000000,-99999999999999999999,-5,5,99999999999999999999,100000000000000000000,1e+30]");
+
+  // doubles out of range
+  EXPECT_EQ(parse("1e400").get_double(), HUGE_VAL);
+  EXPECT_EQ(parse("-1e400").get_double(), -HUGE_VAL);
+  EXPECT_EQ(parse("1e-400").get_double(), 0.0);
+}
+
+TEST_F(JsonTests, deep_destruction) {
+  // deeper than the stack would allow for recursive destructors
+  const int depth = 1000000;
+  Json json;
+  for (int i = 0; i < depth; ++i) {
+    Json::Array array;
+    array.push_back(std::move(json));
+    if (i % 2) {
+      json = Json(std::move(array));
+    } else {
+      Json::Object object;
+      object.emplace("x", Json(std::move(array)));
+      object.emplace("s", Json("a string longer than small string buffer"));
+      json = Json(std::move(object));
+    }
+  }
+  // a shared subtree outlives the value holding it
+  const Json* inner = &json;
+  for (int i = 0; i < depth / 2; ++i) {
+    inner = inner->is_object() ? &(*inner)("x") : &(*inner)[0];
+  }
+  Json shared = inner->share();
+  json = Json();
+  EXPECT_TRUE(shared.is_object() || shared.is_array());
+  shared = Json();
+
+  Json chain(Json::Array{});
+  for (int i = 0; i < depth; ++i) {
+    Json::Array link;
+    link.push_back(chain.share());
+    link.push_back(Json(i));
+    chain = Json(std::move(link));
+  }
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include "concise_json_schema/JsonEmitter.h"
+#include "concise_json_schema/JsonException.h"
+
+using ::testing::Test;
+using namespace JSON;
+
+class JsonEmitterTests : public Test {};
+
+TEST_F(JsonEmitterTests, emit) {
+  std::string out;
+  {
+    StringWriter writer(out);
+    Emitter emitter(writer);
+    emitter.begin_object();
+    emitter.key("a").value(1);
+    emitter.key("b").begin_array().value(true).value(Json::Nil{}).value(2.5).value("x\"y").end_array();
+    emitter.key("c").begin_object().end_object();
+    emitter.key("d").value("[1,{}]"_json);
+    emitter.key("e").begin_array().begin_array().end_array().begin_array().value(false).end_array().end_array();
+    emitter.end_object();
+    EXPECT_EQ(emitter.depth(), 0);
+  }
+  EXPECT_EQ(out, R"({"a":1,"b":[true,null,2.5,"x\"y"],"c":{},"d":[1,{}],"e":[[],[false]]})");
+}
+
+TEST_F(JsonEmitterTests, large_output_in_chunks) {
+  std::ostringstream ss;
+  {
+    StreamWriter writer(ss);
+    Emitter emitter(writer);
+    emitter.begin_array();
+    for (int i = 0; i < 100000; i++) {
+      emitter.value(i);
+    }
+    emitter.end_array();
+  }
+  Json json;
+  std::istringstream(ss.str()) >> json;
+  ASSERT_EQ(json.size(), 100000);
+  EXPECT_EQ(json[99999].get_integer(), 99999);
+}
+
+TEST_F(JsonEmitterTests, unbalanced_close) {
+  std::string out;
+  StringWriter writer(out);
+  EXPECT_THROW(Emitter(writer).end_array(), JsonException);
+  EXPECT_THROW(Emitter(writer).end_object(), JsonException);
+  EXPECT_THROW(Emitter(writer).begin_array().end_object(), JsonException);
+  EXPECT_THROW(Emitter(writer).begin_object().end_array(), JsonException);
+  EXPECT_THROW(Emitter(writer).begin_array().end_array().end_array(), JsonException);
+}
+
+#ifndef NDEBUG
+TEST_F(JsonEmitterTests, structure_checks) {
+  std::string out;
+  StringWriter writer(out);
+  EXPECT_THROW(Emitter(writer).key("x"), JsonException);
+  EXPECT_THROW(Emitter(writer).begin_object().value(1), JsonException);
+  EXPECT_THROW(Emitter(writer).begin_object().key("x").end_object(), JsonException);
+  EXPECT_THROW(Emitter(writer).begin_object().key("x").key("y"), JsonException);
+  EXPECT_THROW(Emitter(writer).value(1).value(2), JsonException);
+}
+#endif
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include "concise_json_schema/JsonException.h"
+#include "concise_json_schema/JsonPatch.h"
+
+using ::testing::Test;
+using namespace JSON;
+
+class JsonPatchTests : public Test {
+ protected:
+  static Json patched(std::string_view document, std::string_view patch) {
+    Json json = parse(document);
+    apply_patch(json, parse(patch));
+    return json;
+  }
+
+  static Json merged(std::string_view document, std::string_view patch) {
+    Json json = parse(document);
+    apply_merge_patch(json, parse(patch));
+    return json;
+  }
+};
+
+TEST_F(JsonPatchTests, operations) {
+  // examples of RFC 6902 appendix A
+  EXPECT_EQ(patched(R"({"foo": "bar"})", R"([{"op": "add", "path": "/baz", "value": "qux"}])"),
+            parse(R"({"baz": "qux", "foo": "bar"})"));
+  EXPECT_EQ(patched(R"({"foo": ["bar", "baz"]})", R"([{"op": "add", "path": "/foo/1", "value": "qux"}])"),
+            parse(R"({"foo": ["bar", "qux", "baz"]})"));
+  EXPECT_EQ(patched(R"({"baz": "qux", "foo": "bar"})", R"([{"op": "remove", "path": "/baz"}])"),
+            parse(R"({"foo": "bar"})"));
+  EXPECT_EQ(patched(R"({"foo": ["bar", "qux", "baz"]})", R"([{"op": "remove", "path": "/foo/1"}])"),
+            parse(R"({"foo": ["bar", "baz"]})"));
+  EXPECT_EQ(patched(R"({"baz": "qux", "foo": "bar"})", R"([{"op": "replace", "path": "/baz", "value": "boo"}])"),
+            parse(R"({"baz": "boo", "foo": "bar"})"));
+  EXPECT_EQ(patched(R"({"foo": {"bar": "baz", "waldo": "fred"}, "qux": {"corge": "grault"}})",
+                    R"([{"op": "move", "from": "/foo/waldo", "path": "/qux/thud"}])"),
+            parse(R"({"foo": {"bar": "baz"}, "qux": {"corge": "grault", "thud": "fred"}})"));
+  EXPECT_EQ(patched(R"({"foo": ["all", "grass", "cows", "eat"]})",
+                    R"([{"op": "move", "from": "/foo/1", "path": "/foo/3"}])"),
+            parse(R"({"foo": ["all", "cows", "eat", "grass"]})"));
+  EXPECT_EQ(patched(R"({"baz": "qux", "foo": ["a", 2, "c"]})",
+                    R"([{"op": "test", "path": "/baz", "value": "qux"}, {"op": "test", "path": "/foo/1", "value": 2}])"),
+            parse(R"({"baz": "qux", "foo": ["a", 2, "c"]})"));
+  EXPECT_EQ(patched(R"({"foo": ["bar"]})", R"([{"op": "add", "path": "/foo/-", "value": ["abc", "def"]}])"),
+            parse(R"({"foo": ["bar", ["abc", "def"]]})"));
+  EXPECT_EQ(patched(R"({"foo": {"a": 1}})", R"([{"op": "copy", "from": "/foo", "path": "/bar"}])"),
+            parse(R"({"foo": {"a": 1}, "bar": {"a": 1}})"));
+  EXPECT_EQ(patched(R"({"foo": 1})", R"([{"op": "replace", "path": "", "value": [1]}])"), parse("[1]"));
+  EXPECT_EQ(patched("[1, 2, 3]", R"([{"op": "replace", "path": "/1", "value": 20}])"), parse("[1, 20, 3]"));
+}
+
+TEST_F(JsonPatchTests, errors) {
+  EXPECT_THROW(patched(R"({"baz": "qux"})", R"([{"op": "test", "path": "/baz", "value": "bar"}])"),
+               JsonPatchException);
+  EXPECT_THROW(patched(R"({"foo": "bar"})", R"([{"op": "add", "path": "/baz/bat", "value": "qux"}])"),
+               JsonPatchException);
+  EXPECT_THROW(patched(R"({"foo": "bar"})", R"([{"op": "remove", "path": "/baz"}])"), JsonPatchException);
+  EXPECT_THROW(patched("[1]", R"([{"op": "add", "path": "/2", "value": 0}])"), JsonPatchException);
+  EXPECT_THROW(patched("[1]", R"([{"op": "remove", "path": "/-"}])"), JsonPatchException);
+  EXPECT_THROW(patched(R"({"a": {"b": 1}})", R"([{"op": "move", "from": "/a", "path": "/a/c"}])"),
+               JsonPatchException);
+  EXPECT_THROW(patched("{}", R"([{"op": "add", "value": 1}])"), JsonPatchException);
+  EXPECT_THROW(patched("{}", R"([{"op": "frobnicate", "path": ""}])"), JsonPatchException);
+  EXPECT_THROW(patched("{}", R"([{"op": "add", "path": "a", "value": 1}])"), JsonPatchException);
+  EXPECT_THROW(patched("{}", R"({"op": "add", "path": "/a", "value": 1})"), JsonPatchException);
+
+  try {
+    patched("{}", R"([{"op": "add", "path": "/a", "value": 1}, {"op": "remove", "path": "/b"}])");
+    FAIL();
+  } catch (JsonPatchException& e) {
+    EXPECT_EQ(e.operation(), 1);
+  }
+}
+
+TEST_F(JsonPatchTests, rollback) {
+  const auto original = parse(R"({"a": [1, 2, 3], "b": {"c": "d"}, "e": "f"})");
+  Json json = original;
+  auto patch = parse(R"([
+    {"op": "add", "path": "/a/0", "value": 0},
+    {"op": "remove", "path": "/a/3"},
+    {"op": "replace", "path": "/e", "value": "g"},
+    {"op": "add", "path": "/b/c", "value": "x"},
+    {"op": "move", "from": "/b", "path": "/a/-"},
+    {"op": "copy", "from": "/a", "path": "/h"},
+    {"op": "move", "from": "/e", "path": "/i"},
+    {"op": "move", "from": "/h", "path": "/missing/h"}
+  ])");
+  EXPECT_THROW(apply_patch(json, patch), JsonPatchException);
+  EXPECT_EQ(json, original);
+
+  // the same patch without the failing operation
+  patch.get_array().pop_back();
+  apply_patch(json, patch);
+  EXPECT_EQ(json, parse(R"({"a": [0, 1, 2, {"c": "x"}], "h": [0, 1, 2, {"c": "x"}], "i": "g"})"));
+  EXPECT_EQ(original, parse(R"({"a": [1, 2, 3], "b": {"c": "d"}, "e": "f"})"));
+}
+
+TEST_F(JsonPatchTests, merge_patch) {
+  // examples of RFC 7386 appendix A
+  EXPECT_EQ(merged(R"({"a": "b"})", R"({"a": "c"})"), parse(R"({"a": "c"})"));
+  EXPECT_EQ(merged(R"({"a": "b"})", R"({"b": "c"})"), parse(R"({"a": "b", "b": "c"})"));
+  EXPECT_EQ(merged(R"({"a": "b"})", R"({"a": null})"), parse("{}"));
+  EXPECT_EQ(merged(R"({"a": "b", "b": "c"})", R"({"a": null})"), parse(R"({"b": "c"})"));
+  EXPECT_EQ(merged(R"({"a": ["b"]})", R"({"a": "c"})"), parse(R"({"a": "c"})"));
+  EXPECT_EQ(merged(R"({"a": "c"})", R"({"a": ["b"]})"), parse(R"({"a": ["b"]})"));
+  EXPECT_EQ(merged(R"({"a": {"b": "c"}})", R"({"a": {"b": "d", "c": null}})"), parse(R"({"a": {"b": "d"}})"));
+  EXPECT_EQ(merged(R"({"a": [{"b": "c"}]})", R"({"a": [1]})"), parse(R"({"a": [1]})"));
+  EXPECT_EQ(merged(R"(["a", "b"])", R"(["c", "d"])"), parse(R"(["c", "d"])"));
+  EXPECT_EQ(merged(R"({"a": "b"})", R"(["c"])"), parse(R"(["c"])"));
+  EXPECT_EQ(merged(R"({"a": "foo"})", "null"), parse("null"));
+  EXPECT_EQ(merged(R"({"a": "foo"})", R"("bar")"), parse(R"("bar")"));
+  EXPECT_EQ(merged(R"({"e": null})", R"({"a": 1})"), parse(R"({"e": null, "a": 1})"));
+  EXPECT_EQ(merged("[1, 2]", R"({"a": "b", "c": null})"), parse(R"({"a": "b"})"));
+  EXPECT_EQ(merged("{}", R"({"a": {"bb": {"ccc": null}}})"), parse(R"({"a": {"bb": {}}})"));
+}
+
+TEST_F(JsonPatchTests, diff) {
+  auto check = [](std::string_view from, std::string_view to, std::string_view expected) {
+    const Json a = parse(from);
+    const Json b = parse(to);
+    Json patch = diff(a, b);
+    EXPECT_EQ(patch, parse(expected)) << from << " -> " << to << ": " << patch;
+    Json json = a;
+    apply_patch(json, patch);
+    EXPECT_EQ(json, b) << from << " -> " << to;
+  };
+  check(R"({"a": 1, "b": [1, 2]})", R"({"a": 1, "b": [1, 2]})", "[]");
+  check("1", "2", R"([{"op": "replace", "path": "", "value": 2}])");
+  check("1", "1.0", R"([{"op": "replace", "path": "", "value": 1.0}])");
+  check(R"({"a": 1, "b": {"c": [1, 2], "d": "x"}, "e": null})", R"({"b": {"c": [1, 2], "d": "y"}, "e": null, "f": 0})",
+        R"([{"op": "remove", "path": "/a"}, {"op": "replace", "path": "/b/d", "value": "y"},
+            {"op": "add", "path": "/f", "value": 0}])");
+  check(R"({"a/b": {"~": 1}})", R"({"a/b": {"~": 2}})", R"([{"op": "replace", "path": "/a~1b/~0", "value": 2}])");
+
+  check("[1, 2, 3, 4]", "[1, 2, 3, 4, 5, 6]",
+        R"([{"op": "add", "path": "/4", "value": 5}, {"op": "add", "path": "/5", "value": 6}])");
+  check("[1, 2, 3, 4]", "[0, 1, 2, 3, 4]", R"([{"op": "add", "path": "/0", "value": 0}])");
+  check("[1, 2, 3, 4]", "[1, 4]", R"([{"op": "remove", "path": "/2"}, {"op": "remove", "path": "/1"}])");
+  check(R"([{"a": 1}, "x", {"b": 2}])", R"([{"a": 1}, {"b": 3}])",
+        R"([{"op": "replace", "path": "/1", "value": {"b": 3}}, {"op": "remove", "path": "/2"}])");
+  check(R"([[1, 2], "x"])", R"([[1, 3], "y", "z"])",
+        R"([{"op": "replace", "path": "/0/1", "value": 3}, {"op": "replace", "path": "/1", "value": "y"},
+            {"op": "add", "path": "/2", "value": "z"}])");
+  check("[1, 1]", "[1]", R"([{"op": "remove", "path": "/1"}])");
+  // packed arrays, compared with each other and with generic ones
+  check("[0.5, 1.5, 2.5]", "[0.5, 3.5, 2.5]", R"([{"op": "replace", "path": "/1", "value": 3.5}])");
+  check("[1, 2]", R"([1, "x", 2])", R"([{"op": "add", "path": "/1", "value": "x"}])");
+  check(R"([1, "x"])", "[1, 2, 3]", R"([{"op": "replace", "path": "/1", "value": 2}, {"op": "add", "path": "/2", "value": 3}])");
+
+  ParseOptions ordered;
+  ordered.preserve_key_order = true;
+  const Json a = parse(R"({"z": 1, "y": {"x": 2}, "w": 3})", ordered);
+  const Json b = parse(R"({"v": 0, "y": {"x": 3}, "z": 1})", ordered);
+  Json json = a;
+  apply_patch(json, diff(a, b));
+  EXPECT_EQ(json, b);
+  EXPECT_EQ(diff(a, b).size(), 3);
+
+  // unchanged parts of a modified copy are shared and skipped
+  Json big = parse(R"({"config": {"a": [1, 2, 3], "b": {"c": "d"}}, "version": 1})");
+  Json next = big.share();
+  next("version") = Json(2);
+  EXPECT_EQ(diff(big, next), parse(R"([{"op": "replace", "path": "/version", "value": 2}])"));
+}
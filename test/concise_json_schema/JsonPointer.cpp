@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include "concise_json_schema/JsonException.h"
+#include "concise_json_schema/JsonPointer.h"
+
+#include <utility>
+
+using ::testing::Test;
+using namespace JSON;
+
+class JsonPointerTests : public Test {};
+
+TEST_F(JsonPointerTests, parse) {
+  EXPECT_TRUE(JsonPointer("").empty());
+  EXPECT_EQ(JsonPointer("/").size(), 1);
+  EXPECT_EQ(JsonPointer("/").back().key, "");
+  EXPECT_EQ(JsonPointer("//x").size(), 2);
+
+  JsonPointer pointer("/a~1b/m~0n/12/-/01");
+  ASSERT_EQ(pointer.size(), 5);
+  EXPECT_EQ(pointer.tokens()[0].key, "a/b");
+  EXPECT_EQ(pointer.tokens()[1].key, "m~n");
+  EXPECT_EQ(pointer.tokens()[1].index, JsonPointer::npos);
+  EXPECT_EQ(pointer.tokens()[2].index, 12);
+  EXPECT_EQ(pointer.tokens()[3].index, JsonPointer::npos);
+  EXPECT_EQ(pointer.tokens()[4].index, JsonPointer::npos);
+  EXPECT_EQ(JsonPointer("/99999999999999999999999").back().index, JsonPointer::npos);
+
+  EXPECT_EQ(to_string(pointer), "/a~1b/m~0n/12/-/01");
+  EXPECT_EQ(to_string(pointer.parent()), "/a~1b/m~0n/12/-");
+  EXPECT_EQ(to_string(JsonPointer()), "");
+  EXPECT_EQ(JsonPointer().push_back("x/y").push_back(3), JsonPointer("/x~1y/3"));
+
+  EXPECT_THROW(JsonPointer("a"), JSONParseException);
+  EXPECT_THROW(JsonPointer("/a~"), JSONParseException);
+  EXPECT_THROW(JsonPointer("/a~2"), JSONParseException);
+}
+
+TEST_F(JsonPointerTests, find) {
+  // examples of RFC 6901 section 5
+  auto json = R"({"foo": ["bar", "baz"], "": 0, "a/b": 1, "c%d": 2, "e^f": 3, "g|h": 4,
+                  "i\\j": 5, "k\"l": 6, " ": 7, "m~n": 8})"_json;
+  const Json& doc = json;
+  EXPECT_EQ(JsonPointer("").find(doc), &doc);
+  EXPECT_EQ(*JsonPointer("/foo").find(doc), R"(["bar", "baz"])"_json);
+  EXPECT_EQ(JsonPointer("/foo/0").find(doc)->get_string(), "bar");
+  std::pair<const char*, int> members[] = {{"/", 0},     {"/a~1b", 1}, {"/c%d", 2}, {"/e^f", 3}, {"/g|h", 4},
+                                           {"/i\\j", 5}, {"/k\"l", 6}, {"/ ", 7},   {"/m~0n", 8}};
+  for (auto& [text, value] : members) {
+    auto found = JsonPointer(text).find(doc);
+    ASSERT_NE(found, nullptr) << text;
+    EXPECT_EQ(found->get_integer(), value) << text;
+  }
+
+  for (auto text : {"/bar", "/foo/2", "/foo/-", "/foo/00", "/foo/bar", "/foo/0/x", "/a~1b/0", "/m~1n"}) {
+    EXPECT_EQ(JsonPointer(text).find(doc), nullptr) << text;
+  }
+}
+
+TEST_F(JsonPointerTests, find_mutable) {
+  auto json = parse(R"({"a": {"b": [1, 2, 3]}})");
+  Json copy = json;
+  Json* found = JsonPointer("/a/b/1").find(json);
+  ASSERT_NE(found, nullptr);
+  *found = Json(20);
+  EXPECT_EQ(json, parse(R"({"a": {"b": [1, 20, 3]}})"));
+  EXPECT_EQ(copy, parse(R"({"a": {"b": [1, 2, 3]}})"));
+  EXPECT_EQ(JsonPointer("/a/c").find(json), nullptr);
+
+  // packed arrays are found by index too
+  const Json doubles = parse("[0.5, 1.5]");
+  ASSERT_NE(doubles.packed_doubles(), nullptr);
+  EXPECT_EQ(JsonPointer("/1").find(doubles)->get_double(), 1.5);
+}
+
+TEST_F(JsonPointerTests, get) {
+  auto json = parse(R"({"a": [1, 2, 3], "b": [0.5, 1.5], "c": ["x", {"d": true}]})");
+  ASSERT_NE(json("a").packed_integers(), nullptr);
+  ASSERT_NE(json("b").packed_doubles(), nullptr);
+  EXPECT_EQ(JsonPointer("/a/2").get(json), Json(3));
+  EXPECT_EQ(JsonPointer("/b/0").get(json), Json(0.5));
+  EXPECT_EQ(JsonPointer("/c/1/d").get(json), Json(true));
+  EXPECT_EQ(JsonPointer("").get(json), json);
+  EXPECT_EQ(JsonPointer("/a/3").get(json), std::nullopt);
+  EXPECT_EQ(JsonPointer("/a/-").get(json), std::nullopt);
+  EXPECT_EQ(JsonPointer("/b/0/x").get(json), std::nullopt);
+  EXPECT_EQ(JsonPointer("/b/0/x").find(std::as_const(json)), nullptr);
+  EXPECT_EQ(JsonPointer("/e").get(json), std::nullopt);
+  // packed elements are read in place, the arrays stay packed
+  EXPECT_NE(json("a").packed_integers(), nullptr);
+  EXPECT_NE(json("b").packed_doubles(), nullptr);
+}
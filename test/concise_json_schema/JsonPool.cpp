@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "concise_json_schema/Json.h"
+#include "concise_json_schema/JsonPool.h"
+
+#include <thread>
+
+using ::testing::Test;
+using namespace JSON;
+
+class JsonPoolTests : public Test {
+ protected:
+  void SetUp() override { trim_pool(); }
+  void TearDown() override { set_pool_enabled(true); }
+
+  const char* text = R"({"a": [1, "s", {"b": [true, null]}], "c": "a string longer than small string buffer"})";
+};
+
+TEST_F(JsonPoolTests, reuse) {
+  auto cycle = [this] {
+    Json json = parse(text);
+    EXPECT_EQ(to_string(json), to_string(parse(text)));
+  };
+  PoolStats base = pool_stats();
+  cycle();
+  PoolStats first = pool_stats();
+  EXPECT_GT(first.kept, base.kept);
+  EXPECT_EQ(first.cached, (first.kept - base.kept) - (first.reused - base.reused));
+  EXPECT_GT(first.cached_bytes, 0);
+  EXPECT_EQ(first.freed - base.freed, first.allocated - base.allocated);
+
+  for (int i = 0; i < 10; ++i) {
+    cycle();
+  }
+  PoolStats after = pool_stats();
+  // every block of later cycles comes from the free lists
+  EXPECT_EQ(after.allocated - first.allocated, after.reused - first.reused);
+  EXPECT_EQ(after.cached, first.cached);
+
+  trim_pool();
+  EXPECT_EQ(pool_stats().cached, 0);
+  EXPECT_EQ(pool_stats().cached_bytes, 0);
+}
+
+TEST_F(JsonPoolTests, disabled) {
+  Json kept = parse(text);
+  set_pool_enabled(false);
+  PoolStats before = pool_stats();
+  Json allocated_while_disabled = parse(text);
+  parse(text);
+  PoolStats after = pool_stats();
+  EXPECT_EQ(after.reused, before.reused);
+  EXPECT_EQ(after.kept, before.kept);
+
+  // blocks allocated while disabled may be cached later
+  set_pool_enabled(true);
+  allocated_while_disabled = Json();
+  kept = Json();
+  EXPECT_GT(pool_stats().kept, after.kept);
+  Json json = parse(text);
+  EXPECT_EQ(json, parse(text));
+}
+
+TEST_F(JsonPoolTests, threads) {
+  // blocks allocated on one thread and freed on others
+  Json json = parse(text);
+  std::vector<Json> copies;
+  for (int i = 0; i < 4; ++i) {
+    copies.push_back(parse(text));
+  }
+  std::vector<std::thread> threads;
+  for (auto& copy : copies) {
+    threads.emplace_back([copy = std::move(copy), this]() mutable {
+      copy = Json();
+      EXPECT_GT(pool_stats().kept, 0);
+      for (int i = 0; i < 100; ++i) {
+        Json local = parse(text);
+        local("a")[0] = Json(i);
+      }
+      EXPECT_GT(pool_stats().reused, 0);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(json, parse(text));
+}
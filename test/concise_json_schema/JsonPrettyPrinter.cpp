@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include "concise_json_schema/JsonPrettyPrinter.h"
+
+using ::testing::Test;
+using namespace JSON;
+
+class JsonPrettyPrinterTests : public Test {};
+
+TEST_F(JsonPrettyPrinterTests, plain_output) {
+  auto json = R"({"a":[1,2.5,{"xyz":[true,null,[]],"b":{}}],"long":{"k":"v\n"},"e":[]})"_json;
+  std::string out;
+  {
+    StringWriter writer(out);
+    json.pretty_print(writer, 2);
+  }
+  EXPECT_EQ(out,
+            "{\n"
+            "  \"a\"   : [\n"
+            "            1,\n"
+            "            2.5,\n"
+            "            {\n"
+            "              \"b\"  : {},\n"
+            "              \"xyz\": [\n"
+            "                       true,\n"
+            "                       null,\n"
+            "                       []\n"
+            "                     ]\n"
+            "            }\n"
+            "          ],\n"
+            "  \"e\"   : [],\n"
+            "  \"long\": {\n"
+            "            \"k\": \"v\\n\"\n"
+            "          }\n"
+            "}");
+  std::ostringstream ss;
+  json.pretty_print(ss, 2);
+  EXPECT_EQ(ss.str(), out);
+}
+
+TEST_F(JsonPrettyPrinterTests, packed_arrays) {
+  auto json = R"({"d":[0.5,1.5],"i":[1,2]})"_json;
+  ASSERT_NE(json("d").packed_doubles(), nullptr);
+  ASSERT_NE(json("i").packed_integers(), nullptr);
+  std::string out;
+  {
+    StringWriter writer(out);
+    json.pretty_print(writer, 2);
+  }
+  EXPECT_EQ(out,
+            "{\n"
+            "  \"d\": [\n"
+            "         0.5,\n"
+            "         1.5\n"
+            "       ],\n"
+            "  \"i\": [\n"
+            "         1,\n"
+            "         2\n"
+            "       ]\n"
+            "}");
+}
+
+TEST_F(JsonPrettyPrinterTests, deep_nesting) {
+  const int depth = 2000;
+  Json json(Json::Array{});
+  Json* inner = &json;
+  for (int i = 0; i < depth; i++) {
+    inner = &inner->push_back(Json(Json::Array{}));
+  }
+  std::string out;
+  {
+    StringWriter writer(out);
+    json.pretty_print(writer, 1);
+  }
+  EXPECT_EQ(std::count(out.begin(), out.end(), '['), depth + 1);
+  EXPECT_EQ(out.substr(out.size() - 3), "]\n]");
+}
@@ -129,3 +129,15 @@ TEST_F(JsonSerializerTests, map_string){
     JSON_ROUND_TRIP(value);
   }
 }
+
+TEST_F(JsonSerializerTests, packed_vectors){
+  std::vector<double> doubles;
+  deserialize(R"([1.5, 2.5])"_json, doubles);
+  EXPECT_EQ(doubles, (std::vector<double>{1.5, 2.5}));
+  deserialize(R"([1, 2])"_json, doubles);
+  EXPECT_EQ(doubles, (std::vector<double>{1, 2}));
+  std::vector<int> ints;
+  deserialize(R"([3, -4])"_json, ints);
+  EXPECT_EQ(ints, (std::vector<int>{3, -4}));
+  EXPECT_THROW(deserialize(R"([3.5])"_json, ints), JsonGetException);
+}
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include "concise_json_schema/JsonException.h"
+#include "concise_json_schema/JsonText.h"
+
+#include <sstream>
+
+using ::testing::Test;
+using namespace JSON;
+
+class JsonTextTests : public Test {
+ protected:
+  static std::string minified(std::string_view text) {
+    std::string out;
+    StringWriter writer(out);
+    minify(text, writer);
+    writer.flush();
+    return out;
+  }
+
+  static std::string reindented(std::string_view text, int tab_size = 2) {
+    std::string out;
+    StringWriter writer(out);
+    reindent(text, writer, tab_size);
+    writer.flush();
+    return out;
+  }
+};
+
+TEST_F(JsonTextTests, minify) {
+  EXPECT_EQ(minified(" { \"a b\" : [ 1 , -2.5e3 /* c */, true,null ] ,\n\t\"c\" :{ } } "),
+            R"({"a b":[1,-2.5e3,true,null],"c":{}})");
+  EXPECT_EQ(minified(R"(["\" /* not a comment */ \\", "\u0041"])"), R"(["\" /* not a comment */ \\","\u0041"])");
+  EXPECT_EQ(minified("1 /**/ 2 {}[]\"x\"true"), "1\n2\n{}\n[]\n\"x\"\ntrue");
+  EXPECT_EQ(minified("/* ** */ 12/**/"), "12");
+  // whitespace runs longer than a SIMD block, ending at every offset within it
+  for (size_t n = 0; n < 40; ++n) {
+    std::string pad = std::string(n, ' ') + "\n\t\r" + std::string(n / 2, '\t');
+    EXPECT_EQ(minified(pad + "[" + pad + "1" + pad + "," + pad + "2" + pad + "]" + pad), "[1,2]");
+  }
+
+  EXPECT_THROW(minified("[1, 2"), JSONParseException);
+  EXPECT_THROW(minified("[1]]"), JSONParseException);
+  EXPECT_THROW(minified("[1,2}"), JSONParseException);
+  EXPECT_THROW(minified("{\"a\":1]"), JSONParseException);
+  EXPECT_THROW(minified("[{]}"), JSONParseException);
+  EXPECT_THROW(minified("\"abc"), JSONParseException);
+  EXPECT_THROW(minified("1 /* 2"), JSONParseException);
+  EXPECT_THROW(minified("1 // 2"), JSONParseException);
+}
+
+TEST_F(JsonTextTests, reindent) {
+  EXPECT_EQ(reindented(R"({"a":[1,{"b":null},[]],"c":{  },"d":"x, y"})"),
+            "{\n"
+            "  \"a\": [\n"
+            "    1,\n"
+            "    {\n"
+            "      \"b\": null\n"
+            "    },\n"
+            "    []\n"
+            "  ],\n"
+            "  \"c\": {},\n"
+            "  \"d\": \"x, y\"\n"
+            "}");
+  EXPECT_EQ(reindented("[1,[2]]", 0), "[\n1,\n[\n2\n]\n]");
+  EXPECT_THROW(reindented("{\"a\":[1}]"), JSONParseException);
+  EXPECT_EQ(minified(reindented(R"({"a":[1,{"b":null},[]],"c":{}})", 3)), R"({"a":[1,{"b":null},[]],"c":{}})");
+}
+
+TEST_F(JsonTextTests, stream_chunks) {
+  // tokens, strings and comments crossing chunk boundaries
+  std::string text = "[";
+  for (int i = 0; i < 20000; ++i) {
+    text += " /* comment */ \"s\\\"" + std::to_string(i) + "\" , " + std::to_string(i) + " ,";
+  }
+  text += "{}]";
+  std::string expected = "[";
+  for (int i = 0; i < 20000; ++i) {
+    expected += "\"s\\\"" + std::to_string(i) + "\"," + std::to_string(i) + ",";
+  }
+  expected += "{}]";
+
+  std::istringstream in(text);
+  std::string out;
+  StringWriter writer(out);
+  minify(in, writer);
+  writer.flush();
+  EXPECT_EQ(out, expected);
+  EXPECT_EQ(operator""_json(out.data(), out.size()), operator""_json(text.data(), text.size()));
+}
+
+TEST_F(JsonTextTests, find_value) {
+  std::string text = R"( {"a": {"b": [10, "x]}", {"c": true}], "s\"q": 1, "\u00e9\ud83d\ude00": 2},
+                          /* {"d": */ "d" : [ [], {} , -1.5e3 ] , "a": 3} )";
+  EXPECT_EQ(find_value(text, JsonPointer("/a/b/0")), "10");
+  EXPECT_EQ(find_value(text, JsonPointer("/a/b/1")), R"("x]}")");
+  EXPECT_EQ(find_value(text, JsonPointer("/a/b/2")), R"({"c": true})");
+  EXPECT_EQ(find_value(text, JsonPointer("/a/b/2/c")), "true");
+  EXPECT_EQ(find_value(text, JsonPointer("/a/s\"q")), "1");
+  EXPECT_EQ(find_value(text, JsonPointer("/a/é\U0001F600")), "2");
+  EXPECT_EQ(find_value(text, JsonPointer("/d/2")), "-1.5e3");
+  EXPECT_EQ(find_value(text, JsonPointer("/d/1")), "{}");
+  EXPECT_EQ(find_value(text, JsonPointer(""))[0], '{');
+  EXPECT_EQ(find_value(text, JsonPointer("")).back(), '}');
+
+  for (auto pointer : {"/x", "/a/b/3", "/a/b/-", "/a/b/0/x", "/d/0/0", "/d/1/x", "/a/b/1/0"}) {
+    EXPECT_TRUE(find_value(text, JsonPointer(pointer)).empty()) << pointer;
+  }
+  EXPECT_THROW(find_value(R"({"a": [1, 2)", JsonPointer("/b")), JSONParseException);
+  EXPECT_THROW(find_value(R"({"a" 1})", JsonPointer("/b")), JSONParseException);
+  EXPECT_THROW(find_value("[1,2}", JsonPointer("")), JSONParseException);
+  EXPECT_THROW(find_value(R"({"a": {"b": 1]})", JsonPointer("/a")), JSONParseException);
+  // the rest is not checked
+  EXPECT_EQ(find_value(R"({"a": 1, "b": [})", JsonPointer("/a")), "1");
+}
+
+TEST_F(JsonTextTests, replace_value) {
+  std::string text = "{\n  \"count\": 41,\n  \"url\": \"http://a/\", /* kept */\n  \"list\": [1, 2, 3]\n}";
+  EXPECT_TRUE(replace_value(text, JsonPointer("/count"), "42"));
+  EXPECT_TRUE(replace_value(text, JsonPointer("/url"), Json("https://b/")));
+  EXPECT_TRUE(replace_value(text, JsonPointer("/list/1"), Json(Json::Array{Json(true)})));
+  EXPECT_FALSE(replace_value(text, JsonPointer("/missing"), "0"));
+  EXPECT_EQ(text, "{\n  \"count\": 42,\n  \"url\": \"https://b/\", /* kept */\n  \"list\": [1, [true], 3]\n}");
+  EXPECT_TRUE(replace_value(text, JsonPointer(""), "null"));
+  EXPECT_EQ(text, "null");
+}
@@ -0,0 +1,326 @@
+#include <gtest/gtest.h>
+
+#include "concise_json_schema/JsonException.h"
+#include "concise_json_schema/JsonWriter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+using ::testing::Test;
+using namespace JSON;
+
+class JsonWriterTests : public Test {
+ public:
+  Json::Array samples{
+      R"({})"_json,
+      R"([])"_json,
+      R"([true,false,null])"_json,
+      R"([[true,null],5, -12, 0, 4.3, 1e99, -1e-99, 123456.5])"_json,
+      R"([[null,true],{"a":"b","c":"d","e":"f"}])"_json,
+      R"({"a":{"b":["x",1,null,false],"":{}}})"_json,
+  };
+};
+
+TEST_F(JsonWriterTests, serialized_size) {
+  for (auto& json : samples) {
+    EXPECT_EQ(serialized_size(json), to_string(json).size()) << json;
+  }
+}
+
+TEST_F(JsonWriterTests, string_writer_appends) {
+  std::string out = "prefix:";
+  {
+    StringWriter writer(out);
+    for (auto& json : samples) {
+      writer.write_json(json);
+    }
+  }
+  std::string expected = "prefix:";
+  for (auto& json : samples) {
+    std::ostringstream ss;
+    ss << json;
+    expected += ss.str();
+  }
+  EXPECT_EQ(out, expected);
+}
+
+TEST_F(JsonWriterTests, stream_writer_large_values) {
+  Json json(Json::Array{});
+  for (int i = 0; i < 1000; i++) {
+    json.push_back(Json(std::string(i * 7, 'x')));
+  }
+  std::ostringstream ss;
+  ss << json;
+  EXPECT_EQ(ss.str(), to_string(json));
+  Json restored;
+  std::istringstream(ss.str()) >> restored;
+  EXPECT_EQ(json, restored);
+}
+
+TEST_F(JsonWriterTests, double_format) {
+  auto format = [](double d) { return to_string(Json(d)); };
+  EXPECT_EQ(format(0.0), "0e+00");
+  EXPECT_EQ(format(15.0), "15.0");
+  EXPECT_EQ(format(-0.5), "-0.5");
+  EXPECT_EQ(format(4.3), "4.3");
+  EXPECT_EQ(format(100000.0), "100000.0");
+  EXPECT_EQ(format(1e99), "1e+99");
+  EXPECT_EQ(format(1e-300), "1e-300");
+  EXPECT_EQ(format(0.1 + 0.2), "0.30000000000000004");
+  EXPECT_THROW(format(std::nan("")), std::runtime_error);
+}
+
+TEST_F(JsonWriterTests, double_round_trip) {
+  std::mt19937_64 gen(42);
+  for (int i = 0; i < 10000; i++) {
+    uint64_t bits = gen();
+    double d;
+    std::memcpy(&d, &bits, sizeof(d));
+    if (std::isnan(d) || std::isinf(d)) {
+      continue;
+    }
+    Json json(d);
+    Json restored;
+    std::istringstream(to_string(json)) >> restored;
+    ASSERT_EQ(json, restored) << to_string(json);
+
+    std::ostringstream pretty;
+    json.pretty_print(pretty);
+    ASSERT_EQ(pretty.str(), to_string(json));
+  }
+}
+
+TEST_F(JsonWriterTests, string_escaping) {
+  EXPECT_EQ(to_string(Json("a\"b\\c/d")), R"("a\"b\\c/d")");
+  EXPECT_EQ(to_string(Json("\b\f\n\r\t")), R"("\b\f\n\r\t")");
+  EXPECT_EQ(to_string(Json(std::string("\x01\x1f\x00", 3))), R"("\u0001\u001f\u0000")");
+  EXPECT_EQ(to_string(Json("caf\xc3\xa9")), "\"caf\xc3\xa9\"");
+  EXPECT_EQ(to_string(Json(Json::Object{{"k\"ey", Json(1)}})), R"({"k\"ey":1})");
+
+  EXPECT_EQ(R"("é😀\/\n")"_json.get_string(), "\xc3\xa9\xf0\x9f\x98\x80/\n");
+  EXPECT_THROW(R"("\x")"_json, JSONParseException);
+  EXPECT_THROW(R"("\u12G4")"_json, JSONParseException);
+
+  std::string all;
+  for (int c = 0; c < 256; c++) {
+    all += char(c);
+  }
+  // long runs exercise vectorized scan including its tail
+  for (size_t length : {0, 1, 15, 16, 17, 31, 33, 100}) {
+    for (size_t shift = 0; shift < 256; shift += 7) {
+      std::string value;
+      for (size_t i = 0; i < length; i++) {
+        value += all[(shift + i * 13) % 256];
+      }
+      Json json(value);
+      std::string text = to_string(json);
+      EXPECT_EQ(text.size(), serialized_size(json));
+      Json restored;
+      std::istringstream(text) >> restored;
+      ASSERT_EQ(restored.get_string(), value);
+    }
+  }
+}
+
+namespace {
+
+std::string read_all(FILE* file) {
+  std::string text;
+  std::rewind(file);
+  char buffer[4096];
+  for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), file)) > 0;) {
+    text.append(buffer, n);
+  }
+  return text;
+}
+
+}
+
+TEST_F(JsonWriterTests, fd_writer) {
+  Json json(Json::Array{});
+  for (int i = 0; i < 3000; i++) {
+    json.push_back(Json(i % 3 ? Json(std::string(i, 'a' + i % 26)) : Json(i)));
+  }
+  json.push_back(Json("tail with \"escapes\"" + std::string(5000, '\n')));
+
+  FILE* file = std::tmpfile();
+  ASSERT_NE(file, nullptr);
+  {
+    FdWriter writer(fileno(file), 256, 4);
+    writer.write_json(json);
+    writer.flush();
+    writer.write_json(Json(42));
+  }
+  std::string text = read_all(file);
+  std::fclose(file);
+  EXPECT_EQ(text, to_string(json) + "42");
+
+  // appended buffers are copied, write_json_parallel() destroys its buffers before flush()
+  Json numbers(Json::Array{});
+  for (int i = 0; i < 20000; i++) {
+    numbers.push_back(Json(std::to_string(i)));
+  }
+  file = std::tmpfile();
+  ASSERT_NE(file, nullptr);
+  {
+    FdWriter writer(fileno(file));
+    write_json_parallel(writer, numbers, 4, 1000);
+  }
+  text = read_all(file);
+  std::fclose(file);
+  EXPECT_EQ(text, to_string(numbers));
+}
+
+TEST_F(JsonWriterTests, parallel) {
+  Json big(Json::Array{});
+  for (int i = 0; i < 20000; i++) {
+    big.push_back(i % 2 ? Json(i) : Json(Json::Object{{"x", Json(i * 0.5)}, {"s", Json(std::to_string(i))}}));
+  }
+  Json object(Json::Object{});
+  for (int i = 0; i < 5000; i++) {
+    object.insert("key" + std::to_string(i), Json(i));
+  }
+  Json json(Json::Object{{"big", big}, {"object", object}, {"small", "[1,2,3]"_json},
+                         {"nested", Json(Json::Array{big, Json(Json::Array{object, Json(1)})})}});
+
+  for (size_t threads : {1, 2, 3, 8}) {
+    std::string out;
+    {
+      StringWriter writer(out);
+      write_json_parallel(writer, json, threads, 1000);
+    }
+    EXPECT_EQ(out, to_string(json));
+  }
+
+  // a writer which sends chunks and references long strings in place, flushed after the call
+  for (size_t threads : {1, 4}) {
+    FILE* file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    {
+      FdWriter writer(fileno(file), 1024, 4);
+      write_json_parallel(writer, json, threads, 1000);
+      writer.flush();
+    }
+    EXPECT_EQ(read_all(file), to_string(json));
+    std::fclose(file);
+  }
+
+  big.push_back(Json(std::nan("")));
+  std::string out;
+  StringWriter writer(out);
+  EXPECT_THROW(write_json_parallel(writer, big, 4, 1000), std::runtime_error);
+}
+
+TEST_F(JsonWriterTests, canonical_form) {
+  ParseOptions options;
+  options.preserve_key_order = true;
+  Json json = parse(R"({"b":[1.0,-0.0,2],"a":{"y":"A\/\n","x":-0.0},"c":[-0.0,1e100]})", options);
+  std::string canonical = to_canonical_string(json);
+  EXPECT_EQ(canonical, R"({"a":{"x":0e+00,"y":"A/\n"},"b":[1.0,0e+00,2],"c":[0e+00,1e+100]})");
+  EXPECT_EQ(to_canonical_string(parse(canonical)), canonical);
+
+  HashWriter empty;
+  EXPECT_EQ(empty.digest(), (HashWriter::Hash128{0, 0}));
+  HashWriter hello;
+  hello.append("hello", 5);
+  EXPECT_EQ(hello.digest(), (HashWriter::Hash128{0xd7bbb0229ac4cfa9ull, 0xc712f86dbda9bad5ull}));
+
+  // streaming hash does not depend on chunking
+  Json big(Json::Array{});
+  for (int i = 0; i < 5000; ++i) {
+    big.push_back(Json(Json::Object{{"k" + std::to_string(i), Json(i * 0.25)}}));
+  }
+  std::string text = to_canonical_string(big);
+  HashWriter whole;
+  whole.append(text);
+  EXPECT_EQ(canonical_hash(big), whole.digest());
+  HashWriter pieces;
+  for (size_t i = 0; i < text.size(); i += 7) {
+    pieces.append(text.data() + i, std::min<size_t>(7, text.size() - i));
+  }
+  EXPECT_EQ(pieces.digest(), whole.digest());
+  EXPECT_EQ(canonical_hash(json), canonical_hash(parse(canonical)));
+  EXPECT_NE(canonical_hash(json), canonical_hash(big));
+}
+
+TEST_F(JsonWriterTests, cached_text) {
+  auto cached = [](const Json& json, size_t min_size) {
+    std::string out;
+    StringWriter writer(out);
+    json.write_cached(writer, min_size);
+    writer.flush();
+    return out;
+  };
+  for (auto& json : samples) {
+    for (size_t min_size : {0, 8, 1024}) {
+      EXPECT_EQ(cached(json, min_size), to_string(json)) << json;
+      // second time from the cache
+      EXPECT_EQ(cached(json, min_size), to_string(json)) << json;
+    }
+  }
+
+  Json json = parse(R"({"a": {"b": [1, 2, {"c": "long enough string"}], "d": [0.5, 1.5]},
+                        "e": [{"f": null}, "long enough string"], "g": 1})");
+  const std::string text = to_string(json);
+  EXPECT_EQ(cached(json, 8), text);
+  Json snapshot = json.share();
+
+  json("a")("b")[2]("c") = Json("x");
+  EXPECT_EQ(cached(json, 8), to_string(json));
+  json("a")("d").push_back(Json(2.5));
+  EXPECT_EQ(cached(json, 8), to_string(json));
+  json("e").get_array().erase(json("e").begin());
+  json("h") = Json(Json::Object{{"i", Json(1)}});
+  EXPECT_EQ(cached(json, 8), to_string(json));
+  EXPECT_EQ(to_string(json),
+            R"({"a":{"b":[1,2,{"c":"x"}],"d":[0.5,1.5,2.5]},"e":["long enough string"],"g":1,"h":{"i":1}})");
+
+  // shared copies share texts, the copy of the unmodified document still has the old one
+  EXPECT_EQ(cached(snapshot, 8), text);
+  Json copy = snapshot.share();
+  EXPECT_EQ(cached(copy, 8), text);
+  copy("g") = Json(2);
+  EXPECT_EQ(cached(copy, 8), to_string(copy));
+  EXPECT_EQ(cached(snapshot, 8), text);
+
+  // a change through a reference obtained before the call
+  Json edited = parse(R"({"a": ["p", "q"]})");
+  Json& a = edited("a");
+  EXPECT_EQ(cached(edited, 0), R"({"a":["p","q"]})");
+  a.push_back(Json("r"));
+  EXPECT_EQ(cached(edited, 0), R"({"a":["p","q","r"]})");
+  // text of the exposed value is released before the writer flushes
+  Json long_text(Json::Array{});
+  for (int i = 0; i < 200; i++) {
+    long_text.push_back(Json(std::string(64, 'a' + i % 26)));
+  }
+  Json& first = long_text[0];
+  first = Json("changed");
+  FILE* file = std::tmpfile();
+  ASSERT_NE(file, nullptr);
+  {
+    FdWriter writer(fileno(file), 256, 64);
+    long_text.write_cached(writer, 0);
+  }
+  EXPECT_EQ(read_all(file), to_string(long_text));
+  std::fclose(file);
+
+  // the same shared value serialized from several threads
+  Json big(Json::Array{});
+  for (int i = 0; i < 2000; i++) {
+    big.push_back(Json(Json::Object{{"x", Json(i)}, {"s", Json(std::to_string(i))}}));
+  }
+  std::vector<std::string> outs(4);
+  std::vector<std::thread> threads;
+  for (auto& out : outs) {
+    threads.emplace_back([&out, &cached, shared = big.share()] { out = cached(shared, 16); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto& out : outs) {
+    EXPECT_EQ(out, to_string(big));
+  }
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include "concise_json_schema/Schema.h"
+#include "concise_json_schema/JsonWriter.h"
 
 using ::testing::Test;
 using namespace JSON;
@@ -18,6 +19,10 @@ public:
       {R"(int(1..10))"_schema, R"(1)"_json, true},
       {R"(int() )"_schema, R"(1)"_json, true},
       {R"(int(..) )"_schema, R"(1)"_json, true},
+      {R"(int)"_schema, R"(99999999999999999999)"_json, true},
+      {R"(int(1..))"_schema, R"(99999999999999999999)"_json, true},
+      {R"(int(..10))"_schema, R"(99999999999999999999)"_json, false},
+      {R"(int(1..))"_schema, R"(-99999999999999999999)"_json, false},
       {R"(anyOf(int,str,bool))"_schema, R"(true)"_json, true},
       {R"(anyOf(int,str,bool))"_schema, R"(3.14)"_json, false},
       {R"(bool)"_schema, R"(true)"_json, true},
@@ -52,6 +57,16 @@ public:
       {R"([int]{1,5})"_schema, R"([1,"s",{}])"_json, false},
       {R"([ unique int]{,5})"_schema, R"([1,2,3])"_json, true},
       {R"([ unique int])"_schema, R"([1,2,3,4,1])"_json, false},
+      {R"([int(0..10)])"_schema, R"([0,5,10])"_json, true},
+      {R"([int(0..10)])"_schema, R"([0,5,11])"_json, false},
+      {R"([int])"_schema, R"([0.5,1.5])"_json, false},
+      {R"([double(..2.0)])"_schema, R"([1,2])"_json, true},
+      {R"([double(..2.0)])"_schema, R"([0.5,2.5])"_json, false},
+      {R"([ unique double])"_schema, R"([0.5,1.5,0.5])"_json, false},
+      {R"([ unique any])"_schema, R"([{"a":1},{"a":2},"x",[1]])"_json, true},
+      {R"([ unique any])"_schema, R"([{"a":[1]},"x",{"a":[1]}])"_json, false},
+      {R"(enum({"a":1},[2]))"_schema, R"([2])"_json, true},
+      {R"(enum({"a":1},[2]))"_schema, R"({"a":2})"_json, false},
       {R"((int,int))"_schema, R"([1,2])"_json, true},
       {R"((int,int,str))"_schema, R"([1,2,"s"])"_json, true},
       {R"(not(null))"_schema, R"([])"_json, true},
@@ -194,3 +209,47 @@ TEST_F(SchemaTests, round_trip){
     }
   }
 }
+
+TEST_F(SchemaTests, plain_wordy_print) {
+  Schema schema = R"({"a": int, "b": [str]})"_schema;
+  Json json = R"({"a": 1, "b": ["x", 2]})"_json;
+  auto m = schema.match(json);
+  ASSERT_FALSE(m);
+  std::string text;
+  {
+    StringWriter writer(text);
+    m.get_error().pretty_wordy_print(writer);
+  }
+  EXPECT_EQ(text.find('\033'), std::string::npos);
+  EXPECT_EQ(text, R"({
+  "a": 1,
+  "b": [
+         "x",
+         2
+         ^^^^^^^^
+         str: not a string //str
+         
+       ]
+       ^^^^^^^^
+       array: bad item[ 1 ] //[str]
+       
+}
+^^^^^^^^
+object: bad property `b` //{"a":int, "b":[str]}
+)");
+}
+
+TEST_F(SchemaTests, wordy_print_packed_element) {
+  // errors of packed array elements are still attached to the element
+  Schema schema = R"([int(..5)])"_schema;
+  Json json = R"([1, 7])"_json;
+  ASSERT_NE(json.packed_integers(), nullptr);
+  auto m = schema.match(json);
+  ASSERT_FALSE(m);
+  std::string text;
+  {
+    StringWriter writer(text);
+    m.get_error().pretty_wordy_print(writer);
+  }
+  EXPECT_NE(text.find("  7\n  ^^^^^^^^\n"), std::string::npos) << text;
+}